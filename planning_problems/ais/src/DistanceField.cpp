@@ -0,0 +1,98 @@
+#include <turtlebot_planner/Ontology/DistanceField.h>
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+#include <turtlebot_planner/Ontology/Shape.h>
+#include <turtlebot_planner/Ontology/Face.h>
+#include <turtlebot_planner/Ontology/SegmentKernel.h>
+
+DistanceField::DistanceField(const std::vector<Shape*>& shapes, float resolution, float max_distance)
+	: min_x_(0), min_y_(0), resolution_(resolution), max_distance_(max_distance), nr_columns_(0), nr_rows_(0), has_faces_(false)
+{
+	std::vector<const Face*> faces;
+	for (std::vector<Shape*>::const_iterator ci = shapes.begin(); ci != shapes.end(); ++ci)
+	{
+		faces.insert(faces.end(), (*ci)->getFaces().begin(), (*ci)->getFaces().end());
+	}
+	
+	if (faces.empty())
+	{
+		return;
+	}
+	has_faces_ = true;
+	
+	float max_x = faces[0]->getP1().x_;
+	float max_y = faces[0]->getP1().y_;
+	min_x_ = max_x;
+	min_y_ = max_y;
+	for (std::vector<const Face*>::const_iterator ci = faces.begin(); ci != faces.end(); ++ci)
+	{
+		const Face* face = *ci;
+		min_x_ = std::min(min_x_, std::min(face->getP1().x_, face->getP2().x_));
+		min_y_ = std::min(min_y_, std::min(face->getP1().y_, face->getP2().y_));
+		max_x = std::max(max_x, std::max(face->getP1().x_, face->getP2().x_));
+		max_y = std::max(max_y, std::max(face->getP1().y_, face->getP2().y_));
+	}
+	
+	// Points further than max_distance_ away from the faces do not need to be stored.
+	min_x_ -= max_distance_;
+	min_y_ -= max_distance_;
+	nr_columns_ = (int)((max_x + max_distance_ - min_x_) / resolution_) + 1;
+	nr_rows_ = (int)((max_y + max_distance_ - min_y_) / resolution_) + 1;
+	distances_.resize(nr_columns_ * nr_rows_, max_distance_ * max_distance_);
+	
+	// Only the cells within max_distance_ of a face can get a smaller distance.
+	for (std::vector<const Face*>::const_iterator ci = faces.begin(); ci != faces.end(); ++ci)
+	{
+		const Vector3D& p1 = (*ci)->getP1();
+		const Vector3D& p2 = (*ci)->getP2();
+		int first_column = std::max(0, (int)floor((std::min(p1.x_, p2.x_) - max_distance_ - min_x_) / resolution_));
+		int last_column = std::min(nr_columns_ - 1, (int)floor((std::max(p1.x_, p2.x_) + max_distance_ - min_x_) / resolution_));
+		int first_row = std::max(0, (int)floor((std::min(p1.y_, p2.y_) - max_distance_ - min_y_) / resolution_));
+		int last_row = std::min(nr_rows_ - 1, (int)floor((std::max(p1.y_, p2.y_) + max_distance_ - min_y_) / resolution_));
+		
+		for (int row = first_row; row <= last_row; ++row)
+		{
+			float y = min_y_ + (row + 0.5f) * resolution_;
+			float* distances = &distances_[row * nr_columns_];
+			for (int column = first_column; column <= last_column; ++column)
+			{
+				float x = min_x_ + (column + 0.5f) * resolution_;
+				float distance = SegmentKernel::getSquaredDistance(x, y, p1.x_, p1.y_, p2.x_, p2.y_);
+				distances[column] = std::min(distances[column], distance);
+			}
+		}
+	}
+	
+	for (std::vector<float>::iterator ci = distances_.begin(); ci != distances_.end(); ++ci)
+	{
+		*ci = std::min((float)sqrt(*ci), max_distance_);
+	}
+}
+
+bool DistanceField::getBounds(const Vector2D& point, float& min_distance, float& max_distance) const
+{
+	if (!has_faces_)
+	{
+		min_distance = std::numeric_limits<float>::max();
+		max_distance = std::numeric_limits<float>::max();
+		return true;
+	}
+	
+	int column = (int)floor((point.x_ - min_x_) / resolution_);
+	int row = (int)floor((point.y_ - min_y_) / resolution_);
+	if (column < 0 || column >= nr_columns_ || row < 0 || row >= nr_rows_)
+	{
+		return false;
+	}
+	
+	// Leave some room for rounding errors.
+	Vector2D centre(min_x_ + (column + 0.5f) * resolution_, min_y_ + (row + 0.5f) * resolution_);
+	float offset = point.getDistance(centre) + 1e-4f;
+	float distance = distances_[row * nr_columns_ + column];
+	min_distance = distance - offset;
+	max_distance = distance >= max_distance_ ? std::numeric_limits<float>::max() : distance + offset;
+	return true;
+}
@@ -0,0 +1,48 @@
+#ifndef TURTLEBOT_PLANNER_ONTOLOGY_DISTANCE_FIELD_H
+#define TURTLEBOT_PLANNER_ONTOLOGY_DISTANCE_FIELD_H
+
+#include <vector>
+
+#include "Vector2D.h"
+
+class Shape;
+
+/**
+ * The distance from points to the nearest (projected) face of a scene in the XY plane, sampled at the centres
+ * of a uniform grid. The distance changes at most as much as the point moves, so the distance at the centre of
+ * a cell bounds the distance of every point in that cell. The distance in 3D is never less than the distance in
+ * the XY plane, so the lower bound holds in 3D as well. Queries whose answer is not clear from these bounds need
+ * to be computed exactly.
+ */
+class DistanceField
+{
+public:
+	/**
+	 * Rasterise all the faces of @ref{shapes}.
+	 * @param shapes The shapes whose faces are stored in the field.
+	 * @param resolution The width and height of a cell.
+	 * @param max_distance Distances larger than this are not stored, only that they are at least this large.
+	 */
+	DistanceField(const std::vector<Shape*>& shapes, float resolution, float max_distance);
+	
+	/**
+	 * Get the bounds on the distance between @ref{point} and the nearest face.
+	 * @param min_distance The lower bound on the distance will be stored here.
+	 * @param max_distance The upper bound on the distance will be stored here.
+	 * @return True if the bounds are known, false if @ref{point} is outside the field.
+	 */
+	bool getBounds(const Vector2D& point, float& min_distance, float& max_distance) const;
+	
+	float getResolution() const { return resolution_; }
+	
+private:
+	float min_x_, min_y_;      // The lower left corner of the field.
+	float resolution_;         // The width and height of a cell.
+	float max_distance_;       // The largest distance that is stored.
+	int nr_columns_, nr_rows_; // The dimensions of the field.
+	bool has_faces_;
+	
+	std::vector<float> distances_; // The distance from the centre of every cell to the nearest face.
+};
+
+#endif
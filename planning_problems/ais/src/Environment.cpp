@@ -1,14 +1,18 @@
 #include <turtlebot_planner/Ontology/Environment.h>
 
+#include <unistd.h>
+
 #include <ontology_db/ontol_access.h>
 #include <turtlebot_planner/Ontology/Scene.h>
 #include <turtlebot_planner/Ontology/Face.h>
 #include <turtlebot_planner/Ontology/Shape.h>
+#include <turtlebot_planner/Ontology/SceneFile.h>
+#include <turtlebot_planner/Ontology/SceneOrder.h>
 
 #include "../OccupancyGridFunction.h"
 
 Environment::Environment(OntolAccess& oa, OccupancyGridFunction& occupancy_grid_function)
-	: oa_(&oa), occupancy_grid_function_(&occupancy_grid_function)
+	: oa_(&oa), occupancy_grid_function_(&occupancy_grid_function), scene_order_(new SceneOrder())
 {
 	
 }
@@ -19,25 +23,63 @@ Environment::~Environment()
 	{
 		delete *ci;
 	}
+	delete scene_order_;
 }
 
 bool Environment::isAccessible(float x, float y)
 {
-	for (std::vector<Scene*>::const_iterator ci = scenes_.begin(); ci != scenes_.end(); ++ci)
+	Vector2D point(x, y);
+	const std::vector<unsigned int>& order = scene_order_->getOrder(point, scenes_.size());
+	for (unsigned int i = 0; i < order.size(); ++i)
 	{
-		if (!(*ci)->isAccessible(x, y))
+		if (!scenes_[order[i]]->isAccessible(x, y))
 		{
+			scene_order_->addResult(point, order[i], i + 1);
 			return false;
 		}
 	}
 	
+	scene_order_->addResult(point, -1, order.size());
 	return true;
 }
 
+bool Environment::canConnect(const Vector2D& from, const Vector2D& to)
+{
+	Vector2D centre = (from + to) / 2.0f;
+	const std::vector<unsigned int>& order = scene_order_->getOrder(centre, scenes_.size());
+	for (unsigned int i = 0; i < order.size(); ++i)
+	{
+		if (!scenes_[order[i]]->canConnect(from, to))
+		{
+			scene_order_->addResult(centre, order[i], i + 1);
+			return false;
+		}
+	}
+	
+	scene_order_->addResult(centre, -1, order.size());
+	return true;
+}
+
+bool Environment::isBlocked(const Vector2D& point, float min_distance)
+{
+	const std::vector<unsigned int>& order = scene_order_->getOrder(point, scenes_.size());
+	for (unsigned int i = 0; i < order.size(); ++i)
+	{
+		if (scenes_[order[i]]->isBlocked(point, min_distance))
+		{
+			scene_order_->addResult(point, order[i], i + 1);
+			return true;
+		}
+	}
+	
+	scene_order_->addResult(point, -1, order.size());
+	return false;
+}
+
 void Environment::reloadScenes(bool ontology_enabled)
 {
 	std::cout << "[Environment::reloadScenes] Delete previous scenes." << std::endl;
-	Scene::clearCache();
+	Scene::startReload();
 	for (std::vector<Scene*>::const_iterator ci = scenes_.begin(); ci != scenes_.end(); ++ci)
 	{
 		delete *ci;
@@ -64,6 +106,17 @@ void Environment::reloadScenes(bool ontology_enabled)
 			}
 			*/
 		}
+		
+		// Store the scenes, such that the next start can use them without the ontology. Unchanged scenes are not written again.
+		if (!snapshot_file_.empty() && !scenes_.empty())
+		{
+			SceneFile::saveSnapshot(snapshot_file_, scenes_, snapshot_source_);
+		}
+	}
+	else if (!snapshot_file_.empty() && access(snapshot_file_.c_str(), R_OK) == 0)
+	{
+		std::cout << "[Environment::reloadScenes] Load the scenes of " << snapshot_source_ << " from the snapshot: " << snapshot_file_ << "." << std::endl;
+		SceneFile::load(snapshot_file_, occupancy_grid_function_, scenes_, snapshot_source_);
 	}
 	
 	// If there are no scenes then we will load an empty one.
@@ -73,6 +126,31 @@ void Environment::reloadScenes(bool ontology_enabled)
 		Scene* empty_scene = new Scene(shapes, *occupancy_grid_function_);
 		scenes_.push_back(empty_scene);
 	}
+	Scene::finishReload();
+	scene_order_->reset(scenes_.size());
+}
+
+bool Environment::loadScenes(const std::string& file_name)
+{
+	std::cout << "[Environment::loadScenes] Delete previous scenes." << std::endl;
+	Scene::startReload();
+	for (std::vector<Scene*>::const_iterator ci = scenes_.begin(); ci != scenes_.end(); ++ci)
+	{
+		delete *ci;
+	}
+	scenes_.clear();
+	Face::deleteFaces();
+	
+	std::cout << "[Environment::loadScenes] Load the scenes from: " << file_name << "." << std::endl;
+	bool is_loaded = SceneFile::load(file_name, occupancy_grid_function_, scenes_);
+	Scene::finishReload();
+	scene_order_->reset(scenes_.size());
+	return is_loaded;
+}
+
+bool Environment::saveScenes(const std::string& file_name) const
+{
+	return SceneFile::save(file_name, scenes_);
 }
 
 bool Environment::isFullyConnected(Waypoint& enter_waypoint, Waypoint& exit_waypoint, const std::vector<Waypoint*>& waypoints, const std::vector<Waypoint*>& inspection_points, std::vector<Waypoint*>& unconnected_inspection_points)
@@ -12,6 +12,7 @@ class OntolAccess;
 class Waypoint;
 class OccupancyGridFunction;
 class Face;
+class SceneOrder;
 
 /**
  * The ontology stores scenes which are based on the known shapes an observations so far. This class 
@@ -29,11 +30,46 @@ public:
 	 */
 	bool isAccessible(float x, float y);
 	
+	/**
+	 * Check if the line segment from @ref{from} to @ref{to} can be traversed in all scenes (see Scene::canConnect).
+	 */
+	bool canConnect(const Vector2D& from, const Vector2D& to);
+	
+	/**
+	 * Check if @ref{point} is blocked in any scene (see Scene::isBlocked).
+	 */
+	bool isBlocked(const Vector2D& point, float min_distance);
+	
+	/**
+	 * Get the order in which @ref{isAccessible}, @ref{canConnect} and @ref{isBlocked} test the scenes, and their counters.
+	 */
+	const SceneOrder& getSceneOrder() const { return *scene_order_; }
+	
 	/**
 	 * Get all the scenes from the ontology and replace the existing set.
 	 */
 	void reloadScenes(bool ontology_enabled);
 	
+	/**
+	 * Replace the existing scenes with the scenes stored in a scene file (see @ref{SceneFile}).
+	 * @return True if the file could be read, false otherwise.
+	 */
+	bool loadScenes(const std::string& file_name);
+	
+	/**
+	 * Store the current scenes in a scene file (see @ref{SceneFile}), such that they can be loaded without the ontology.
+	 * @return True if the file could be written, false otherwise.
+	 */
+	bool saveScenes(const std::string& file_name) const;
+	
+	/**
+	 * Set the snapshot (see @ref{SceneFile::saveSnapshot}) that @ref{reloadScenes} writes after the scenes are loaded
+	 * from the ontology, if they changed, and loads the scenes from when the ontology is disabled.
+	 * @param file_name The name of the snapshot, empty to disable the snapshot (the default).
+	 * @param source The source of the scenes; a snapshot of another source is not loaded.
+	 */
+	void setSnapshotFile(const std::string& file_name, const std::string& source) { snapshot_file_ = file_name; snapshot_source_ = source; }
+	
 	/**
 	 * Load a test environment for testing.
 	 */
@@ -92,6 +128,9 @@ private:
 	std::vector<Scene*> scenes_;
 	OntolAccess *oa_;
 	OccupancyGridFunction* occupancy_grid_function_;
+	std::string snapshot_file_;
+	std::string snapshot_source_;
+	SceneOrder* scene_order_; // The scenes that are most likely to fail a check are tested first.
 };
 
 #endif
@@ -7,6 +7,8 @@
 #include <ontology_db/ontol_access.h>
 
 std::vector<Face*> Face::faces_;
+std::map<Face::Bucket, std::vector<unsigned int> > Face::buckets_;
+const float Face::BUCKET_SIZE = 0.05f;
 //std::map<const Face*, std::string> Face::face_to_pddl_name_;
 
 const std::vector< Face*>& Face::getFaces() { return faces_; }
@@ -18,62 +20,62 @@ void Face::deleteFaces()
 		delete *ci;
 	}
 	faces_.clear();
+	buckets_.clear();
 }
 
 Face* Face::getFace(Shape& shape, const Face& face, bool face_is_observed)
 {
-	Face* new_face = new Face(shape, face, face_is_observed);
-	if (new_face->ignore_face_)
-	{
-		delete new_face;
-		return NULL;
-	}
-	
-	// Check if this face is similar to an existing face. If so, we take that face's name!
-	bool found_similar_face = false;
-	for (std::vector<Face*>::const_iterator ci = faces_.begin(); ci != faces_.end(); ++ci)
-	{
-		Face* face = *ci;
-		if (face->isSimilarTo(*new_face))
-		{
-			delete new_face;
-			face->shapes_.push_back(&shape);
-			return face;
-		}
-	}
-	
-	std::stringstream ss;
-	ss << "FACE" << faces_.size();
-	new_face->pddl_name_ = ss.str();
-	faces_.push_back(new_face);
-	return new_face;
+	return addFace(shape, new Face(shape, face, face_is_observed));
 }
 
 Face* Face::getFace(Shape& shape, OntolAccess& oa, const std::string& face_name, bool face_is_observed)
 {
-	Face* new_face = new Face(shape, oa, face_name, face_is_observed);
+	return addFace(shape, new Face(shape, oa, face_name, face_is_observed));
+}
+
+Face* Face::addFace(Shape& shape, Face* new_face)
+{
 	if (new_face->ignore_face_)
 	{
 		delete new_face;
 		return NULL;
 	}
 	
-	// Check if this face is similar to an existing face. If so, we take that face's name!
-	bool found_similar_face = false;
-	for (std::vector<Face*>::const_iterator ci = faces_.begin(); ci != faces_.end(); ++ci)
+	// Check if this face is similar to an existing face. If so, we take that face's name! Only the
+	// neighbouring buckets can contain similar faces; of those we take the one that was stored first.
+	int similar_face_index = -1;
+	for (int x_offset = -1; x_offset <= 1; ++x_offset)
 	{
-		Face* face = *ci;
-		if (face->isSimilarTo(*new_face))
+		for (int y_offset = -1; y_offset <= 1; ++y_offset)
 		{
-			delete new_face;
-			face->shapes_.push_back(&shape);
-			return face;
+			std::map<Bucket, std::vector<unsigned int> >::const_iterator bucket = buckets_.find(Bucket(*new_face, x_offset, y_offset));
+			if (bucket == buckets_.end())
+			{
+				continue;
+			}
+			
+			for (std::vector<unsigned int>::const_iterator ci = (*bucket).second.begin(); ci != (*bucket).second.end(); ++ci)
+			{
+				if ((similar_face_index == -1 || (int)*ci < similar_face_index) && faces_[*ci]->isSimilarTo(*new_face))
+				{
+					similar_face_index = *ci;
+				}
+			}
 		}
 	}
 	
+	if (similar_face_index != -1)
+	{
+		Face* face = faces_[similar_face_index];
+		delete new_face;
+		face->shapes_.push_back(&shape);
+		return face;
+	}
+	
 	std::stringstream ss;
 	ss << "FACE" << faces_.size();
 	new_face->pddl_name_ = ss.str();
+	buckets_[Bucket(*new_face, 0, 0)].push_back(faces_.size());
 	faces_.push_back(new_face);
 	return new_face;
 }
@@ -194,6 +196,23 @@ Face::Face(Shape& shape, const Face& face, bool face_is_observed)
 	std::cout << "Loaded: " << *this << std::endl;
 }
 
+Face::Face(Shape& shape, const std::string& face_name, const Vector3D& p1, const Vector3D& p2, const Vector3D& normal, int hue, int saturation, int value, bool face_is_observed)
+	: face_name_(face_name), hue_(hue), saturation_(saturation), value_(value), p1_(p1), p2_(p2), normal_vector_(normal), has_been_observed_(face_is_observed)
+{
+	p1_transformed_ = shape.getRotationMatrix().rotate(p1_);
+	p2_transformed_ = shape.getRotationMatrix().rotate(p2_);
+	
+	p1_transformed_ += shape.getLocation();
+	p2_transformed_ += shape.getLocation();
+	
+	// If this face is too small, ignore it!
+	Vector2D p1_proj(p1_transformed_.x_, p1_transformed_.y_);
+	Vector2D p2_proj(p2_transformed_.x_, p2_transformed_.y_);
+	ignore_face_ = p1_proj.getDistance(p2_proj) < 0.1f;
+	
+	normal_vector_transformed_ = shape.getRotationMatrix().rotate(normal_vector_);
+}
+
 bool Face::isSimilarTo(const Face& other) const
 {
 	return isSimilarTo(other.hue_, other.saturation_, other.value_, other.p1_transformed_, other.p2_transformed_);
@@ -248,6 +267,23 @@ bool Face::isSimilarTo(int other_hue, int other_saturation, int other_value, con
 	return false;
 }
 
+Face::Bucket::Bucket(const Face& face, int x_offset, int y_offset)
+	: hue_(face.getHue()), saturation_(face.getSaturation()), value_(face.getValue())
+{
+	// Similar faces have both end points less than 0.05 apart, so their centres are less than 0.025 apart.
+	x_ = (int)floor((face.getP1().x_ + face.getP2().x_) / 2.0f / BUCKET_SIZE) + x_offset;
+	y_ = (int)floor((face.getP1().y_ + face.getP2().y_) / 2.0f / BUCKET_SIZE) + y_offset;
+}
+
+bool Face::Bucket::operator<(const Bucket& other) const
+{
+	if (hue_ != other.hue_) return hue_ < other.hue_;
+	if (saturation_ != other.saturation_) return saturation_ < other.saturation_;
+	if (value_ != other.value_) return value_ < other.value_;
+	if (x_ != other.x_) return x_ < other.x_;
+	return y_ < other.y_;
+}
+
 std::ostream& operator<<(std::ostream& os, const Face& face)
 {
 	os << face.getPDDLName() << ": " << face.getP1() << " <-> " << face.getP2() << "HSV: " << face.getHue() << ", " << face.getSaturation() << ", " << face.getValue() << "; observed? " << face.isObserved();
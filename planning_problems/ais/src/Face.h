@@ -22,6 +22,11 @@ public:
 	
 	Face(Shape& shape, const Face& face, bool face_is_observed);
 	
+	/**
+	 * Construct a face from its corners in the reference frame of @ref{shape} -- debug purposes.
+	 */
+	Face(Shape& shape, const std::string& face_name, const Vector3D& p1, const Vector3D& p2, const Vector3D& normal, int hue, int saturation, int value, bool face_is_observed);
+	
 	static Face* getFace(Shape& shape, OntolAccess& oa, const std::string& face_name, bool face_is_observed);
 	static Face* getFace(Shape& shape, const Face& face, bool face_is_observed);
 	static const std::vector< Face*>& getFaces();
@@ -45,6 +50,25 @@ public:
 	
 	bool ignoreFace() const { return ignore_face_; }
 private:
+	/**
+	 * Store @ref{new_face}, unless a similar face exists. In that case @ref{new_face} is deleted and the
+	 * similar face is returned instead.
+	 */
+	static Face* addFace(Shape& shape, Face* new_face);
+	
+	/**
+	 * Faces are only similar if they have the same colour and their centres are less than
+	 * BUCKET_SIZE / 2 apart, so a similar face is always in a bucket next to the face's bucket.
+	 */
+	struct Bucket
+	{
+		Bucket(const Face& face, int x_offset, int y_offset);
+		bool operator<(const Bucket& other) const;
+		
+		int hue_, saturation_, value_;
+		int x_, y_;
+	};
+	static const float BUCKET_SIZE;
 	
 	std::vector<Shape*> shapes_;
 	std::string face_name_;
@@ -62,6 +86,7 @@ private:
 	bool has_been_observed_; // Flag to indicate whether this face has already been observed.
 	
 	static std::vector<Face*> faces_;
+	static std::map<Bucket, std::vector<unsigned int> > buckets_; // The indices in faces_ of the faces in every bucket.
 	//static std::map<const Face*, std::string> face_to_pddl_name_; // In order to give faces that are similar we store the name globably.
 };
 
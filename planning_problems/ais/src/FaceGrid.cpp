@@ -0,0 +1,218 @@
+#include <turtlebot_planner/Ontology/FaceGrid.h>
+
+#include <algorithm>
+#include <math.h>
+
+#include <turtlebot_planner/Ontology/Shape.h>
+#include <turtlebot_planner/Ontology/Face.h>
+#include <turtlebot_planner/Ontology/SegmentKernel.h>
+
+FaceGrid::FaceGrid(const std::vector<Shape*>& shapes, float cell_size)
+	: min_x_(0), min_y_(0), cell_size_(cell_size), nr_columns_(0), nr_rows_(0)
+{
+	for (std::vector<Shape*>::const_iterator ci = shapes.begin(); ci != shapes.end(); ++ci)
+	{
+		const Shape* shape = *ci;
+		faces_.insert(faces_.end(), shape->getFaces().begin(), shape->getFaces().end());
+	}
+
+	if (faces_.empty())
+	{
+		return;
+	}
+
+	float max_x = faces_[0]->getP1().x_;
+	float max_y = faces_[0]->getP1().y_;
+	min_x_ = max_x;
+	min_y_ = max_y;
+	for (std::vector<const Face*>::const_iterator ci = faces_.begin(); ci != faces_.end(); ++ci)
+	{
+		const Face* face = *ci;
+		min_x_ = std::min(min_x_, std::min(face->getP1().x_, face->getP2().x_));
+		min_y_ = std::min(min_y_, std::min(face->getP1().y_, face->getP2().y_));
+		max_x = std::max(max_x, std::max(face->getP1().x_, face->getP2().x_));
+		max_y = std::max(max_y, std::max(face->getP1().y_, face->getP2().y_));
+	}
+
+	nr_columns_ = (int)((max_x - min_x_) / cell_size_) + 1;
+	nr_rows_ = (int)((max_y - min_y_) / cell_size_) + 1;
+	cells_.resize(nr_columns_ * nr_rows_);
+
+	// Every point of a cell is within half a diagonal of its centre, so a face passes through all the
+	// cells whose centre is within this distance of the face.
+	float half_diagonal = cell_size_ * sqrt(2.0f) / 2.0f;
+	std::vector<unsigned int> cells;
+	for (unsigned int face_id = 0; face_id < faces_.size(); ++face_id)
+	{
+		const Face* face = faces_[face_id];
+		cells.clear();
+		getCells(Vector2D(face->getP1().x_, face->getP1().y_), Vector2D(face->getP2().x_, face->getP2().y_), half_diagonal, cells);
+		for (std::vector<unsigned int>::const_iterator ci = cells.begin(); ci != cells.end(); ++ci)
+		{
+			Cell& cell = cells_[*ci];
+			cell.face_ids_.push_back(face_id);
+			cell.x1_.push_back(face->getP1().x_);
+			cell.y1_.push_back(face->getP1().y_);
+			cell.z1_.push_back(face->getP1().z_);
+			cell.x2_.push_back(face->getP2().x_);
+			cell.y2_.push_back(face->getP2().y_);
+			cell.z2_.push_back(face->getP2().z_);
+		}
+	}
+}
+
+void FaceGrid::getCandidates(const Vector2D& from, const Vector2D& to, float margin, std::vector<unsigned int>& face_ids) const
+{
+	// A face within margin of the segment has a point within margin of it; that point lies in a cell
+	// whose centre is at most margin + half a diagonal away from the segment.
+	float half_diagonal = cell_size_ * sqrt(2.0f) / 2.0f;
+	std::vector<unsigned int> cells;
+	getCells(from, to, margin + half_diagonal, cells);
+
+	face_ids.clear();
+	for (std::vector<unsigned int>::const_iterator ci = cells.begin(); ci != cells.end(); ++ci)
+	{
+		face_ids.insert(face_ids.end(), cells_[*ci].face_ids_.begin(), cells_[*ci].face_ids_.end());
+	}
+	std::sort(face_ids.begin(), face_ids.end());
+	face_ids.erase(std::unique(face_ids.begin(), face_ids.end()), face_ids.end());
+}
+
+bool FaceGrid::isNearSegment(const Vector2D& from, const Vector2D& to, float distance) const
+{
+	// A face can be stored in multiple cells, but testing it more than once is cheaper than removing the duplicates.
+	float half_diagonal = cell_size_ * sqrt(2.0f) / 2.0f;
+	std::vector<unsigned int> cells;
+	getCells(from, to, distance + half_diagonal, cells);
+	for (std::vector<unsigned int>::const_iterator ci = cells.begin(); ci != cells.end(); ++ci)
+	{
+		const Cell& cell = cells_[*ci];
+		if (!cell.face_ids_.empty() &&
+		    SegmentKernel::findSegmentWithin(&cell.x1_[0], &cell.y1_[0], &cell.x2_[0], &cell.y2_[0], cell.face_ids_.size(), from.x_, from.y_, to.x_, to.y_, distance) != -1)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FaceGrid::isNearPoint(const Vector3D& point, float distance) const
+{
+	// The distance in 3D is never less than the distance in the XY plane, so the cells near the projected point suffice.
+	float half_diagonal = cell_size_ * sqrt(2.0f) / 2.0f;
+	Vector2D projected_point(point.x_, point.y_);
+	std::vector<unsigned int> cells;
+	getCells(projected_point, projected_point, distance + half_diagonal, cells);
+	for (std::vector<unsigned int>::const_iterator ci = cells.begin(); ci != cells.end(); ++ci)
+	{
+		const Cell& cell = cells_[*ci];
+		if (!cell.face_ids_.empty() &&
+		    SegmentKernel::findSegmentNear(&cell.x1_[0], &cell.y1_[0], &cell.z1_[0], &cell.x2_[0], &cell.y2_[0], &cell.z2_[0], cell.face_ids_.size(), point.x_, point.y_, point.z_, distance) != -1)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FaceGrid::getCells(const Vector2D& from, const Vector2D& to, float distance, std::vector<unsigned int>& cells) const
+{
+	int first_row = std::max(0, (int)floor((std::min(from.y_, to.y_) - distance - min_y_) / cell_size_));
+	int last_row = std::min(nr_rows_ - 1, (int)floor((std::max(from.y_, to.y_) + distance - min_y_) / cell_size_));
+
+	// Only visit the columns of every row whose centre is near the segment, instead of the whole bounding box of
+	// the segment, which is mostly empty for long diagonal segments.
+	for (int row = first_row; row <= last_row; ++row)
+	{
+		float min_x, max_x;
+		if (!getRange(from, to, distance, min_y_ + (row + 0.5f) * cell_size_, min_x, max_x))
+		{
+			continue;
+		}
+
+		int first_column = std::max(0, (int)ceil((min_x - min_x_) / cell_size_ - 0.5f));
+		int last_column = std::min(nr_columns_ - 1, (int)floor((max_x - min_x_) / cell_size_ - 0.5f));
+		for (int column = first_column; column <= last_column; ++column)
+		{
+			cells.push_back(row * nr_columns_ + column);
+		}
+	}
+}
+
+bool FaceGrid::getRange(const Vector2D& from, const Vector2D& to, float distance, float y, float& min_x, float& max_x)
+{
+	// The points within distance of the segment form a convex set, so on the line they form the smallest range
+	// that contains the ranges of its parts: the discs around both end points and the band along the segment.
+	bool is_found = false;
+	const Vector2D* end_points[] = { &from, &to };
+	for (unsigned int i = 0; i < 2; ++i)
+	{
+		float offset = y - end_points[i]->y_;
+		if (fabs(offset) <= distance)
+		{
+			float half_width = sqrt(distance * distance - offset * offset);
+			extendRange(end_points[i]->x_ - half_width, end_points[i]->x_ + half_width, is_found, min_x, max_x);
+		}
+	}
+
+	float dx = to.x_ - from.x_;
+	float dy = to.y_ - from.y_;
+	float offset = y - from.y_;
+	if (dy != 0.0f)
+	{
+		// The points within distance of the line through the segment...
+		float length = sqrt(dx * dx + dy * dy);
+		float band_x1 = from.x_ + (dx * offset - distance * length) / dy;
+		float band_x2 = from.x_ + (dx * offset + distance * length) / dy;
+		float band_min_x = std::min(band_x1, band_x2);
+		float band_max_x = std::max(band_x1, band_x2);
+
+		// ...that are projected between its end points.
+		if (dx != 0.0f)
+		{
+			float projection_x1 = from.x_ - offset * dy / dx;
+			float projection_x2 = from.x_ + (length * length - offset * dy) / dx;
+			band_min_x = std::max(band_min_x, std::min(projection_x1, projection_x2));
+			band_max_x = std::min(band_max_x, std::max(projection_x1, projection_x2));
+		}
+		else if (offset / dy < 0.0f || offset / dy > 1.0f)
+		{
+			band_min_x = band_max_x + 1.0f;
+		}
+
+		if (band_min_x <= band_max_x)
+		{
+			extendRange(band_min_x, band_max_x, is_found, min_x, max_x);
+		}
+	}
+	else if (fabs(offset) <= distance)
+	{
+		extendRange(std::min(from.x_, to.x_), std::max(from.x_, to.x_), is_found, min_x, max_x);
+	}
+
+	// Rounding errors may only add cells, never remove them.
+	min_x -= 0.001f;
+	max_x += 0.001f;
+	return is_found;
+}
+
+void FaceGrid::extendRange(float begin, float end, bool& is_found, float& min_x, float& max_x)
+{
+	min_x = is_found ? std::min(min_x, begin) : begin;
+	max_x = is_found ? std::max(max_x, end) : end;
+	is_found = true;
+}
+
+float FaceGrid::getDistance(const Vector2D& point, const Vector2D& begin, const Vector2D& end)
+{
+	Vector2D direction = end - begin;
+	float length_squared = direction.x_ * direction.x_ + direction.y_ * direction.y_;
+	if (length_squared == 0.0f)
+	{
+		return point.getDistance(begin);
+	}
+
+	float t = ((point.x_ - begin.x_) * direction.x_ + (point.y_ - begin.y_) * direction.y_) / length_squared;
+	t = std::max(0.0f, std::min(1.0f, t));
+	return point.getDistance(begin + direction * t);
+}
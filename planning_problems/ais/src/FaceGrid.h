@@ -0,0 +1,88 @@
+#ifndef TURTLEBOT_PLANNER_ONTOLOGY_FACE_GRID_H
+#define TURTLEBOT_PLANNER_ONTOLOGY_FACE_GRID_H
+
+#include <vector>
+
+#include "Vector2D.h"
+#include "Vector3D.h"
+
+class Face;
+class Shape;
+
+/**
+ * A uniform grid over the (projected) faces of a scene. Every face is stored in all the cells it passes
+ * through, such that geometric queries only need to test the faces that are near the query instead of
+ * all the faces in the scene.
+ */
+class FaceGrid
+{
+public:
+	/**
+	 * Build the grid over all the faces of @ref{shapes}.
+	 * @param shapes The shapes whose faces are stored in the grid.
+	 * @param cell_size The width and height of a cell.
+	 */
+	FaceGrid(const std::vector<Shape*>& shapes, float cell_size = 0.5f);
+
+	/**
+	 * Collect the faces that might be within @ref{margin} of the line segment from @ref{from} to @ref{to}.
+	 * Faces that are further away are never returned, but not every returned face needs to be that close.
+	 * @param from The begin point of the line segment.
+	 * @param to The end point of the line segment.
+	 * @param margin The maximum distance between the line segment and a face.
+	 * @param face_ids The ids of the faces (see @ref{getFace}) will be stored here, without duplicates.
+	 */
+	void getCandidates(const Vector2D& from, const Vector2D& to, float margin, std::vector<unsigned int>& face_ids) const;
+
+	/**
+	 * Check if any face is closer than @ref{distance} to the line segment from @ref{from} to @ref{to}, in the XY plane.
+	 */
+	bool isNearSegment(const Vector2D& from, const Vector2D& to, float distance) const;
+
+	/**
+	 * Check if any face is closer than @ref{distance} to @ref{point}.
+	 */
+	bool isNearPoint(const Vector3D& point, float distance) const;
+
+	const Face& getFace(unsigned int face_id) const { return *faces_[face_id]; }
+	unsigned int getNumberOfFaces() const { return faces_.size(); }
+
+	/**
+	 * Get the distance between a point and a line segment in the XY plane.
+	 */
+	static float getDistance(const Vector2D& point, const Vector2D& begin, const Vector2D& end);
+
+private:
+	/**
+	 * Visit all the cells whose centre is within @ref{distance} of the given line segment.
+	 */
+	void getCells(const Vector2D& from, const Vector2D& to, float distance, std::vector<unsigned int>& cells) const;
+
+	/**
+	 * Get the range [@ref{min_x}, @ref{max_x}] of the points on the horizontal line at @ref{y} that are within
+	 * @ref{distance} of the line segment from @ref{from} to @ref{to}, it may be slightly too large.
+	 * @return False if no point on the line is that close.
+	 */
+	static bool getRange(const Vector2D& from, const Vector2D& to, float distance, float y, float& min_x, float& max_x);
+
+	/**
+	 * Extend the range [@ref{min_x}, @ref{max_x}] such that it contains [@ref{begin}, @ref{end}].
+	 * @param is_found False if the range is still empty, true afterwards.
+	 */
+	static void extendRange(float begin, float end, bool& is_found, float& min_x, float& max_x);
+
+	float min_x_, min_y_;        // The lower left corner of the grid.
+	float cell_size_;            // The width and height of a cell.
+	int nr_columns_, nr_rows_;   // The dimensions of the grid.
+
+	struct Cell
+	{
+		std::vector<unsigned int> face_ids_;           // The faces that pass through this cell.
+		std::vector<float> x1_, y1_, z1_, x2_, y2_, z2_; // Their end points, one array per coordinate.
+	};
+
+	std::vector<const Face*> faces_; // All the faces in the grid, indexed by their id.
+	std::vector<Cell> cells_;
+};
+
+#endif
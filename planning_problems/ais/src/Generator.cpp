@@ -3,6 +3,13 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "CPGenerator.h"
 
@@ -11,6 +18,11 @@
 #include "Scene.h"
 #include "Environment.h"
 #include "Shape.h"
+#include "ShapeQueryCache.h"
+#include "SceneOrder.h"
+#include "PlanParser.h"
+#include "PlannerPortfolio.h"
+#include "RosOntologyWriter.h"
 
 Generator::Generator(ros::NodeHandle& ros_node, OccupancyGridFunction& occupancy_grid_function, const std::string& planner_command_line, bool disable_ontology)
 	: ros_node_(&ros_node), occupancy_grid_function_(&occupancy_grid_function), planner_command_line_(planner_command_line), oa_(new OntolAccess(ros_node)), environment_(new Environment(*oa_, occupancy_grid_function)), disable_ontology_(disable_ontology)
@@ -28,9 +40,229 @@ Generator::Generator(ros::NodeHandle& ros_node, OccupancyGridFunction& occupancy
 	
 	Waypoint::initWaypoints(ros_node, *oa_);
 	
+	// The scenes of the ontology can be stored in a snapshot, without the ontology they are loaded from it. This is off
+	// unless ~scene_snapshot names the file; a snapshot is only loaded for the same ~scene_snapshot_source (e.g. the map).
+	std::string snapshot_file;
+	std::string snapshot_source;
+	ros::param::param<std::string>("~scene_snapshot", snapshot_file, "");
+	ros::param::param<std::string>("~scene_snapshot_source", snapshot_source, ros::this_node::getName());
+	environment_->setSnapshotFile(snapshot_file, snapshot_source);
+	
 	srand(time(NULL));
 }
 
+/**
+ * For every area of interest, the locations of the waypoints that connected its inspection points the last time
+ * generatePlan was called for it; these are tried before any random waypoints are generated. The waypoints of one
+ * area are never offered to another, whose bounds and inspection points differ.
+ */
+static std::map<std::string, std::vector<Vector2D> > previous_waypoints;
+
+/**
+ * Append the configuration that won the planner portfolio to planner_portfolio.log, such that the configurations
+ * can be compared over many runs.
+ * @param aoi_id The area of interest that was planned for.
+ * @param configurations All the configurations in the portfolio.
+ * @param winner The index of the winning configuration.
+ * @param seconds The time it took the winner to start its plan.
+ */
+static void logPortfolioWinner(const std::string& aoi_id, const std::vector<std::string>& configurations, unsigned int winner, double seconds)
+{
+	std::cout << "The planner configuration " << winner << " (" << configurations[winner] << ") won in " << seconds << " seconds." << std::endl;
+	if (configurations.size() < 2)
+	{
+		return;
+	}
+	
+	std::ofstream log("planner_portfolio.log", std::ios::app);
+	log << aoi_id << "\t" << configurations.size() << "\t" << winner << "\t" << seconds << "\t" << configurations[winner] << std::endl;
+}
+
+/**
+ * Create a linear plan for a single scene, in the same format as the output of FF. The robot moves from
+ * @ref{enter} to the closest inspection point it has not visited yet and senses its view cone, until every
+ * reachable inspection point has been visited.
+ * @param scene The scene in which the waypoints are connected.
+ * @param enter The location of the robot.
+ * @param inspection_points The inspection points to visit.
+ * @param waypoints All the waypoints the robot can move to.
+ * @return The plan.
+ */
+static std::string generateFallbackPlan(const Scene& scene, Waypoint& enter, const std::vector<Waypoint*>& inspection_points, const std::vector<Waypoint*>& waypoints)
+{
+	scene.connectWaypoints(waypoints);
+	
+	std::stringstream plan;
+	unsigned int step = 0;
+	Waypoint* location = &enter;
+	std::vector<Waypoint*> remaining_inspection_points(inspection_points);
+	std::vector<std::vector<Waypoint*> > paths;
+	while (!remaining_inspection_points.empty())
+	{
+		paths.clear();
+		scene.findPaths(*location, remaining_inspection_points, paths);
+		
+		int closest = -1;
+		float closest_distance = 0;
+		for (unsigned int i = 0; i < paths.size(); ++i)
+		{
+			if (paths[i].empty()) continue;
+			
+			float distance = 0;
+			for (unsigned int j = 1; j < paths[i].size(); ++j)
+			{
+				distance += paths[i][j - 1]->getDistanceTo(*paths[i][j]);
+			}
+			if (closest == -1 || distance < closest_distance)
+			{
+				closest = i;
+				closest_distance = distance;
+			}
+		}
+		
+		if (closest == -1)
+		{
+			std::cerr << "[generateFallbackPlan] " << remaining_inspection_points.size() << " inspection points cannot be reached." << std::endl;
+			break;
+		}
+		
+		const std::vector<Waypoint*>& path = paths[closest];
+		for (unsigned int i = 1; i < path.size(); ++i)
+		{
+			plan << (step == 0 ? "step " : "     ") << std::setw(4) << step << ": NAVIGATE TURTLEBOT " << path[i - 1]->predicate_ << " " << path[i]->predicate_ << std::endl;
+			++step;
+		}
+		location = path.back();
+		plan << (step == 0 ? "step " : "     ") << std::setw(4) << step << ": SENSE-VIEW-CONE TURTLEBOT " << location->predicate_ << std::endl;
+		++step;
+		remaining_inspection_points.erase(remaining_inspection_points.begin() + closest);
+	}
+	return plan.str();
+}
+
+/**
+ * The work queue shared by the threads of @ref{runTasks}.
+ */
+template <typename Task>
+struct TaskQueue
+{
+	std::vector<Task>* tasks_;
+	void (*process_)(Task&);
+	unsigned int next_task_;
+	pthread_mutex_t mutex_;
+};
+
+template <typename Task>
+static void* processTaskQueue(void* argument)
+{
+	TaskQueue<Task>* queue = static_cast<TaskQueue<Task>*>(argument);
+	while (true)
+	{
+		pthread_mutex_lock(&queue->mutex_);
+		unsigned int task_nr = queue->next_task_++;
+		pthread_mutex_unlock(&queue->mutex_);
+		
+		if (task_nr >= queue->tasks_->size())
+		{
+			return NULL;
+		}
+		queue->process_((*queue->tasks_)[task_nr]);
+	}
+}
+
+/**
+ * Run @ref{process} on all the @ref{tasks} on a pool with a thread per core (but no more threads than tasks). If no
+ * threads can be created the tasks are run on the calling thread.
+ */
+template <typename Task>
+static void runTasks(std::vector<Task>& tasks, void (*process)(Task&))
+{
+	TaskQueue<Task> queue;
+	queue.tasks_ = &tasks;
+	queue.process_ = process;
+	queue.next_task_ = 0;
+	pthread_mutex_init(&queue.mutex_, NULL);
+	
+	long nr_cores = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int nr_threads = std::min<unsigned int>(nr_cores > 0 ? nr_cores : 1, tasks.size());
+	std::vector<pthread_t> threads;
+	for (unsigned int i = 1; i < nr_threads; ++i)
+	{
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, processTaskQueue<Task>, &queue) != 0)
+		{
+			break;
+		}
+		threads.push_back(thread);
+	}
+	
+	// The calling thread takes part as well.
+	processTaskQueue<Task>(&queue);
+	for (std::vector<pthread_t>::const_iterator ci = threads.begin(); ci != threads.end(); ++ci)
+	{
+		pthread_join(*ci, NULL);
+	}
+	pthread_mutex_destroy(&queue.mutex_);
+}
+
+/**
+ * The candidate locations from which a single face or view point can be observed, see @ref{selectViewingLocation}.
+ */
+struct ViewingLocationTask
+{
+	Environment* environment_;
+	const Face* face_;                 // The face to observe, NULL if a view point is observed.
+	Vector2D target_;                  // The centre of the face or the view point.
+	std::vector<Vector2D> candidates_; // The locations to choose from, in order of preference.
+	Vector2D best_viewing_location_;
+	unsigned int most_scenes_;         // The number of scenes in which the target is visible from the best location.
+};
+
+/**
+ * Find the candidate of @ref{task} from which the target is visible in the most scenes; if several candidates are
+ * equally good the first one is chosen, so the result does not depend on the order in which the tasks are run.
+ * Candidates to observe a face must be accessible in every scene. This only reads the scenes, so multiple tasks
+ * can run at the same time.
+ */
+static void selectViewingLocation(ViewingLocationTask& task)
+{
+	const std::vector<Vector2D>& candidates = task.candidates_;
+	std::vector<bool> is_valid(candidates.size(), true);
+	if (task.face_ != NULL)
+	{
+		for (unsigned int i = 0; i < candidates.size(); ++i)
+		{
+			is_valid[i] = task.environment_->isAccessible(candidates[i].x_, candidates[i].y_);
+		}
+	}
+	
+	// Test all the candidates against one scene before moving to the next.
+	std::vector<unsigned int> visibility(candidates.size(), 0);
+	for (std::vector<Scene*>::const_iterator ci = task.environment_->getScenes().begin(); ci != task.environment_->getScenes().end(); ++ci)
+	{
+		const Scene* scene = *ci;
+		for (unsigned int i = 0; i < candidates.size(); ++i)
+		{
+			if (is_valid[i] && (task.face_ != NULL ? scene->canSee(*task.face_, candidates[i]) : scene->canSee(task.target_, candidates[i])))
+			{
+				++visibility[i];
+			}
+		}
+	}
+	
+	task.most_scenes_ = 0;
+	for (unsigned int i = 0; i < candidates.size(); ++i)
+	{
+		if (visibility[i] > task.most_scenes_)
+		{
+			task.best_viewing_location_ = candidates[i];
+			task.most_scenes_ = visibility[i];
+		}
+	}
+}
+
+static void mergeIndistinguishableScenes(std::vector<Scene*>& scenes, std::vector<float>& probabilities, const std::vector<Waypoint*>& waypoints, const std::vector<Vector2D>& view_points);
+
 bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, turtlebot_common::GeneratePlan::Response &res)
 {
 	std::cout << "[CPGenerator::generatePlan] " << std::endl;
@@ -50,10 +282,12 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 #ifdef USE_ALTERNATIVE_VIEW_POINT_GENERATION
 	view_point_generator_->generateWaypoints(*environment_, view_points, faces, 10);
 	
-	// Check if there are faces we want to observe, if then these could be targets. Focus on them!
-	for (std::vector<const Face*>::const_iterator ci = faces.begin(); ci != faces.end(); ++ci)
+	// Check if there are faces we want to observe, if then these could be targets. Focus on them! The candidate
+	// locations of all the faces are tested in parallel, the waypoints are created afterwards in the order of the faces.
+	std::vector<ViewingLocationTask> face_tasks(faces.size());
+	for (unsigned int face_nr = 0; face_nr < faces.size(); ++face_nr)
 	{
-		const Face* face = *ci;
+		const Face* face = faces[face_nr];
 		const Vector3D& normal_vector = face->getNormal();
 		Vector3D face_centre = (face->getP1() + face->getP2()) / 2.0f;
 		
@@ -61,39 +295,29 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 		Vector2D face_centre_2d(face_centre.x_, face_centre.y_);
 		Vector2D orthogonal_normal_vector_2d(-normal_vector.y_, normal_vector.x_);
 		
-		unsigned int most_scenes = 0;
-		Vector2D best_viewing_location;
-		
+		ViewingLocationTask& task = face_tasks[face_nr];
+		task.environment_ = environment_;
+		task.face_ = face;
+		task.target_ = face_centre_2d;
 		for (float distance = 5.0f; distance >= 1.0f; distance -= 0.5f)
 		{
 			for (float side = -distance; side < distance; side += 0.5f)
 			{
-				Vector2D viewing_location = face_centre_2d + normal_vector_2d * distance + orthogonal_normal_vector_2d * side;
-				
-				if (!environment_->isAccessible(viewing_location.x_, viewing_location.y_)) continue;
-				
-				unsigned int visibility = 0;
-				for (std::vector<Scene*>::const_iterator ci = environment_->getScenes().begin(); ci != environment_->getScenes().end(); ++ci)
-				{
-					const Scene* scene = *ci;
-					if (scene->canSee(*face, viewing_location))
-					{
-						++visibility;
-					}
-				}
-				
-				if (visibility > most_scenes)
-				{
-					best_viewing_location = viewing_location;
-					most_scenes = visibility;
-				}
+				task.candidates_.push_back(face_centre_2d + normal_vector_2d * distance + orthogonal_normal_vector_2d * side);
 			}
 		}
+	}
+	runTasks(face_tasks, selectViewingLocation);
+	
+	for (std::vector<ViewingLocationTask>::const_iterator ci = face_tasks.begin(); ci != face_tasks.end(); ++ci)
+	{
+		const ViewingLocationTask& task = *ci;
 		
 		// Generate its waypoint.
-		if (most_scenes > 0)
+		if (task.most_scenes_ > 0)
 		{
-			Waypoint& inspection_point = Waypoint::generateWaypoint(best_viewing_location.x_, best_viewing_location.y_, atan2(face_centre.y_ - best_viewing_location.y_, face_centre.x_ - best_viewing_location.x_));
+			const Vector2D& best_viewing_location = task.best_viewing_location_;
+			Waypoint& inspection_point = Waypoint::generateWaypoint(best_viewing_location.x_, best_viewing_location.y_, atan2(task.target_.y_ - best_viewing_location.y_, task.target_.x_ - best_viewing_location.x_));
 			inspection_points.push_back(&inspection_point);
 		}
 	}
@@ -101,44 +325,37 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 	// If there are no interesting faces, we are interested in looking 'behind' faces we have observed.
 	if (inspection_points.empty())
 	{
-		for (std::vector<Vector2D>::const_iterator ci = view_points.begin(); ci != view_points.end(); ++ci)
+		std::vector<ViewingLocationTask> view_point_tasks(view_points.size());
+		for (unsigned int view_point_nr = 0; view_point_nr < view_points.size(); ++view_point_nr)
 		{
-			const Vector2D& view_point = *ci;
-			unsigned int most_scenes = 0;
-			Vector2D best_viewing_location;
+			const Vector2D& view_point = view_points[view_point_nr];
 			
+			ViewingLocationTask& task = view_point_tasks[view_point_nr];
+			task.environment_ = environment_;
+			task.face_ = NULL;
+			task.target_ = view_point;
 			for (float distance = 1.0f; distance < 5.0f; distance += 0.5f)
 			{
 				for (float angle = 0; angle < M_PI * 2; angle += M_PI / 8.0f)
 				{
 					Vector2D view(1, 0);
 					view.rotate(angle);
-					Vector2D viewing_location =  view_point + view * distance;
-					
-					unsigned int visibility = 0;
-					for (std::vector<Scene*>::const_iterator ci = environment_->getScenes().begin(); ci != environment_->getScenes().end(); ++ci)
-					{
-						const Scene* scene = *ci;
-						if (scene->canSee(view_point, viewing_location))
-						{
-							++visibility;
-						}
-					}
-					
-					std::cout << " *** " << viewing_location << " -> " << visibility << ". Angle: " << angle << " - rot " << view << std::endl;
-					
-					if (visibility > most_scenes)
-					{
-						best_viewing_location = viewing_location;
-						most_scenes = visibility;
-					}
+					task.candidates_.push_back(view_point + view * distance);
 				}
 			}
+		}
+		runTasks(view_point_tasks, selectViewingLocation);
+		
+		for (std::vector<ViewingLocationTask>::const_iterator ci = view_point_tasks.begin(); ci != view_point_tasks.end(); ++ci)
+		{
+			const ViewingLocationTask& task = *ci;
+			std::cout << " *** " << task.target_ << " is visible in " << task.most_scenes_ << " scenes from " << task.best_viewing_location_ << std::endl;
 			
 			// Generate its waypoint.
-			if (most_scenes > 0)
+			if (task.most_scenes_ > 0)
 			{
-				Waypoint& inspection_point = Waypoint::generateWaypoint(best_viewing_location.x_, best_viewing_location.y_, atan2(view_point.y_ - best_viewing_location.y_, view_point.x_ - best_viewing_location.x_));
+				const Vector2D& best_viewing_location = task.best_viewing_location_;
+				Waypoint& inspection_point = Waypoint::generateWaypoint(best_viewing_location.x_, best_viewing_location.y_, atan2(task.target_.y_ - best_viewing_location.y_, task.target_.x_ - best_viewing_location.x_));
 				inspection_points.push_back(&inspection_point);
 			}
 		}
@@ -204,19 +421,7 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 			{
 				Waypoint* inspection_point = *ri;
 				Vector2D inspection_point_2d(inspection_point->x_, inspection_point->y_);
-				bool is_valid_inspection_point = true;
-				for (std::vector<Scene*>::const_iterator ci = environment_->getScenes().begin(); ci != environment_->getScenes().end(); ++ci)
-				{
-					Scene* scene = *ci;
-					
-					if (scene->isBlocked(inspection_point_2d, 0.25f))
-					{
-						is_valid_inspection_point = false;
-						break;
-					}
-				}
-				
-				if (!is_valid_inspection_point)
+				if (environment_->isBlocked(inspection_point_2d, 0.25f))
 				{
 					inspection_points.erase((ri + 1).base());
 					std::cout << "Ignore the inspection point as it is too close to possible obstructions: " << *inspection_point << "." << std::endl;
@@ -310,6 +515,20 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 	//view_points.clear();
 	//faces.clear();
 
+	// Start with the waypoints of the previous plan, unless a shape that was added or moved blocks them now. If the
+	// scenes changed little these connect most points again and their line segments are still cached (see Scene::startReload).
+	std::vector<Vector2D>& previous_aoi_waypoints = previous_waypoints[aoi_id];
+	unsigned int nr_reused_waypoints = 0;
+	for (std::vector<Vector2D>::const_iterator ci = previous_aoi_waypoints.begin(); ci != previous_aoi_waypoints.end(); ++ci)
+	{
+		if (!environment_->isBlocked(*ci, 0.25f))
+		{
+			all_waypoints.push_back(new Waypoint("", "", (*ci).x_, (*ci).y_, 0));
+			++nr_reused_waypoints;
+		}
+	}
+	std::cout << "Reused " << nr_reused_waypoints << " of the " << previous_aoi_waypoints.size() << " waypoints of the previous plan." << std::endl;
+	
 	// Generate new waypoints until we can link every exit, entry, and inspection point in every possible scene.
 	unsigned int loop_count = 0;
 	std::vector<Waypoint*> unconnected_inspection_points;
@@ -324,8 +543,9 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 				std::cout << "(" << all_waypoints.size() << ")";
 			}
 			
-			// Try reducing the number of inspection points if we fail to connect them up.
-			if (all_waypoints.size() > 50)
+			// Try reducing the number of inspection points if we fail to connect them up. Only the waypoints that
+			// were sampled for this plan count, the reused ones did not fail to connect anything yet.
+			if (all_waypoints.size() - nr_reused_waypoints > 50)
 			{
 				std::cout << "Reduce the number of inspection points we are considering." << std::endl;
 				for (int i = inspection_points.size() - 1; i > -1; --i)
@@ -401,16 +621,15 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 	{
 		const Scene* scene = *ci;
 		
-		for (int i = 0; i < inspection_points.size(); ++i)
+		scene->connectWaypoints(all_waypoints);
+		
+		// A single search from every source finds the paths to all the inspection points after it, the waypoints
+		// on these paths are collected from the shortest path tree of the search.
+		scene->addPathWaypoints(enter_waypoint, inspection_points, necessary_waypoints);
+		for (int i = 0; i + 1 < inspection_points.size(); ++i)
 		{
-			std::vector<Waypoint*> path = scene->findPath(enter_waypoint, *inspection_points[i], all_waypoints);
-			necessary_waypoints.insert(path.begin(), path.end());
-			
-			for (int j = i + 1; j < inspection_points.size(); ++j)
-			{
-				path = scene->findPath(*inspection_points[i], *inspection_points[j], all_waypoints);
-				necessary_waypoints.insert(path.begin(), path.end());
-			}
+			std::vector<Waypoint*> targets(inspection_points.begin() + i + 1, inspection_points.end());
+			scene->addPathWaypoints(*inspection_points[i], targets, necessary_waypoints);
 		}
 	}
 	
@@ -445,9 +664,11 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 	std::cout << "Create actual waypoints. " << std::endl;
 	// Those remaining will be added to the actual waypoints.
 	//for (std::vector<Waypoint*>::const_iterator ci = all_waypoints.begin(); ci != all_waypoints.end(); ++ci)
+	previous_aoi_waypoints.clear();
 	for (unsigned int i = waypoints.size(); i < all_waypoints.size(); ++i)
 	{
 		Waypoint* tmp_waypoint = all_waypoints[i];
+		previous_aoi_waypoints.push_back(Vector2D(tmp_waypoint->x_, tmp_waypoint->y_));
 		
 		Waypoint& waypoint = Waypoint::generateWaypoint(tmp_waypoint->x_, tmp_waypoint->y_, 0);
 		waypoints.push_back(&waypoint);
@@ -497,19 +718,7 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 		for (std::vector<Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
 		{
 			const Waypoint* other_waypoint = *ci;
-			bool can_connect = true;
-			for (std::vector<Scene*>::const_iterator ci = environment_->getScenes().begin(); ci != environment_->getScenes().end(); ++ci)
-			{
-				const Scene* scene = *ci;
-				
-				if (!scene->canConnect(Vector2D(other_waypoint->x_, other_waypoint->y_), Vector2D(waypoint->x_, waypoint->y_)))
-				{
-					can_connect = false;
-					break;
-				}
-			}
-			
-			if (can_connect)
+			if (environment_->canConnect(Vector2D(other_waypoint->x_, other_waypoint->y_), Vector2D(waypoint->x_, waypoint->y_)))
 			{
 				visualization_msgs::Marker line_marker;
 				line_marker.header.frame_id = "/map";
@@ -568,9 +777,16 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 	std::cout << "Processed " << scenes.size() << " scenes." << std::endl;
 	std::cout << "All the points are fully connected with " << waypoints.size() << " waypoints." << std::endl;
 	
+	const SceneOrder& scene_order = environment_->getSceneOrder();
+	std::cout << "Checks in all scenes: " << scene_order.getNumberOfChecks() << ", scenes tested: " << scene_order.getNumberOfTests() << ", failed checks: " << scene_order.getNumberOfFailures() << " (" << scene_order.getNumberOfFirstSceneFailures() << " in the first scene tested)." << std::endl;
+	
 	std::vector<Scene*> most_probably_scenes;
 	environment_->getMostProbableScenes(most_probably_scenes, 10);
 	
+	// Every scene becomes a state of the planning problem, so scenes the planner cannot tell apart are merged.
+	std::vector<float> scene_probabilities;
+	mergeIndistinguishableScenes(most_probably_scenes, scene_probabilities, waypoints, view_points);
+	
 	// Create the planning domain and problem.
 	std::ofstream domain_file;
 	domain_file.open("mars_domain.pddl");
@@ -582,256 +798,263 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 	generateProblemFile(problem_file, inspection_points, waypoints, enter_waypoint, exit_waypoint, view_points, faces, most_probably_scenes);
 	problem_file.close();
 
-	// Run the planner.
+	// Run the planners, every line of the planner command line is a configuration. Each planner runs in its own
+	// process group, such that it can be stopped when another planner wins or it runs out of time.
 	std::cout << "Start the planner!" << std::endl;
 	ros::WallTime start_ff = ros::WallTime::now();
-	std::stringstream ss;
-	ss << planner_command_line_ << " -o mars_domain.pddl -f mars_problem.pddl &> out";
-	FILE* file = popen(ss.str().c_str(), "r");
+	std::vector<std::string> configurations;
+	PlannerPortfolio::getCommandLines(planner_command_line_, configurations);
+	if (configurations.empty())
+	{
+		configurations.push_back(planner_command_line_);
+	}
+	std::vector<std::string> command_lines;
+	for (unsigned int i = 0; i < configurations.size(); ++i)
+	{
+		std::stringstream ss;
+		ss << configurations[i] << " -o mars_domain.pddl -f mars_problem.pddl &> out";
+		if (i > 0)
+		{
+			ss << i;
+		}
+		command_lines.push_back(ss.str());
+	}
+	PlannerPortfolio planners(command_lines);
 	
-	char c;
-	std::stringstream plan_ss;
-	while ((c = fgetc(file)) != EOF)
+	// Store the waypoints in the ontology while the planners run.
+	OntologyWriter& waypoint_writer = Waypoint::getOntologyWriter();
+	if (!waypoint_writer.flush())
 	{
-		plan_ss << c;
-		printf("%c", c);
+		std::cerr << "Could not store all the waypoints in the ontology!" << std::endl;
 	}
-	pclose(file);
-	ros::WallTime end_ff = ros::WallTime::now();
-	std::cout << "Found a plan!" << std::endl;
-	//system(ss.str().c_str());
-
-	ontology_db::CreateInstanceOfClass create_instance;
-	create_instance.request.class_name = "plan:'ContingentPlan'";
-	if (!create_instances_client_.call(create_instance))
+	std::cout << "Stored the waypoints in the ontology with " << waypoint_writer.getNumberOfCalls() << " calls for " << waypoint_writer.getNumberOfWrites() << " writes." << std::endl;
+	
+	// The plan is stored in the ontology while the planner is running, so create the plan first. Its actions and
+	// all the properties are written once the whole plan has been read, such that an incomplete plan can be dropped.
+	RosOntologyWriter ontology_writer(*ros_node_, *oa_, &create_sproperty_client_);
+	std::string contingent_plan_instance_name = ontology_writer.createInstance("plan:'ContingentPlan'");
+	if (contingent_plan_instance_name.empty())
 	{
 		std::cout << "Failed to add a contingent plan to the ontology!" << std::endl;
 	}
-	std::cout << "Created a contingent plan instance with the name: " << create_instance.response.instance_name << std::endl;
-	std::string contingent_plan_instance_name = create_instance.response.instance_name;
+	std::cout << "Created a contingent plan instance with the name: " << contingent_plan_instance_name << std::endl;
 	
 	// Add this contingency plan to the AoI.
-	ontology_db::CreateStringPropertyValues aoi_has_plan_property;
-	aoi_has_plan_property.request.instance_name = aoi_id;
-	aoi_has_plan_property.request.property_name = "plan:'planForArea'";
-	aoi_has_plan_property.request.values.push_back(contingent_plan_instance_name);
-	if (!create_sproperty_client_.call(aoi_has_plan_property))
+	ontology_writer.addStringPropertyValue(aoi_id, "plan:'planForArea'", contingent_plan_instance_name);
+
+	// The planners may use whatever is left of the time limit. The first planner that outputs a plan wins.
+	if (time_limit > 0)
 	{
-		std::cerr << "Could not add the contingency plan: " << contingent_plan_instance_name << " to the AoI " << aoi_id << std::endl;
+		planners.setTimeLimit(time_limit - (start_ff - start_gen_plan).toSec());
 	}
-	else
+	int winner = planners.race();
+	if (winner != -1)
 	{
-		std::cout << "Add the contingency plan: " << contingent_plan_instance_name << " to the AoI " << aoi_id << std::endl;
+		logPortfolioWinner(aoi_id, configurations, winner, (ros::WallTime::now() - start_ff).toSec());
 	}
-
-	// Read the out file and store the resulting plan in the ontology.
-	size_t prev_i = 0;
-	size_t next_i = 0;
-	bool found_first_action = false;
+	
+	// Store every action of the plan in the ontology as soon as the planner outputs it.
+	PlanParser& planner_output = planners.getOutput(winner == -1 ? 0 : winner);
+	std::auto_ptr<PlanParser> fallback_output;
+	PlanParser* plan_parser = &planner_output;
+	
+	std::string full_action;
+	std::string action_name;
 	std::vector<std::string> stack;
 	std::string last_added_action;
 
 	BRANCH current_branch = FIRST;
 	
-	while ((next_i = plan_ss.str().find('\n', prev_i)) != std::string::npos)
+	while (true)
 	{
-		std::string s = plan_ss.str().substr(prev_i, next_i - prev_i);
-		
-		std::cout << "Process: " << s << std::endl;
-		
-		prev_i = next_i + 1;
-		if (!found_first_action && s.find("step    0:") != std::string::npos)
+		if (!plan_parser->getNextAction(full_action, action_name))
 		{
-			found_first_action = true;
-		}
-
-		if (!found_first_action) continue;
-
-		size_t action_i = s.find(':');	
-		if (action_i != std::string::npos)
-		{
-			std::cout << "A: " << s.substr(action_i + 2, s.size() - (action_i + 2)) << std::endl;
-			std::string full_action = s.substr(action_i + 2, s.size() - (action_i + 2));
-
-			std::string action_name = s.substr(action_i + 2, s.find(" ", action_i + 2) - (action_i + 2));
-			std::cout << "Processing: " << action_name << std::endl;
-			if ("RAMINIFICATE" == action_name)
-			{
-				std::cout << "Skipping " << action_name << std::endl;
-				continue;
-			}
-			else if ("POP" == action_name)
-			{
-				std::cout << "POP! - stack size " << stack.size() << std::endl;
-				last_added_action = stack[stack.size() - 1];
-				stack.erase(stack.end() - 1);
-				current_branch = FAIL;
-				continue;
-			}
-			
-			// Add the action to the response.
-			std::vector<std::string> action_parameters;
-			char * action_copy = new char[full_action.length() + 1];
-			std::strcpy(action_copy, full_action.c_str());
-			char *p = strtok(action_copy, " ");
-			while (p)
-			{
-				action_parameters.push_back(std::string(p));
-				p = strtok(NULL, " ");
-			}
-			
-			//if ("SENSE" == action_name || "OBSERVE-WALL" == action_name || "SENSE-VIEW-CONE" == action_name)
-			if ("OBSERVE-WALL" == action_name)
-			{
-				create_instance.request.class_name = "plan:'ObservationAction'";
-			}
-			else
-			{
-				create_instance.request.class_name = "plan:'PlanAction'";
-			}
-			if (!create_instances_client_.call(create_instance))
+			// If the planner ran out of time before the plan was complete, drop what it gave and use a linear plan
+			// instead.
+			if (plan_parser != &planner_output || !planner_output.hasTimedOut())
 			{
-				std::cout << "Failed to add an action to the ontology!" << std::endl;
+				break;
 			}
-			std::string action_instance_name = create_instance.response.instance_name;
-			std::cout << "Created an action instance with the name: " << action_instance_name << std::endl;
+			planners.stop();
 			
-			// Set the properties.
-			std::vector<std::string> name_list;
-			name_list.push_back(full_action);
-			ontology_db::CreateStringPropertyValues set_svalues;
-			set_svalues.request.instance_name = action_instance_name;
-			set_svalues.request.property_name = "plan:'actionName'";
-			set_svalues.request.values = name_list;
-			if (!create_sproperty_client_.call(set_svalues))
+			if (current_branch != FIRST)
 			{
-				std::cerr << "Could not set the action name for the action: " << action_instance_name << " " << full_action << std::endl;
+				std::cout << "The planner ran out of time, drop the incomplete plan." << std::endl;
+				ontology_writer.discard();
+				ontology_writer.addStringPropertyValue(aoi_id, "plan:'planForArea'", contingent_plan_instance_name);
+				res.first_action.clear();
+				stack.clear();
+				last_added_action.clear();
+				current_branch = FIRST;
 			}
-			else
+			if (scenes.empty())
 			{
-				std::cout << "Action name is set: " << action_instance_name << " " << full_action << std::endl;
+				break;
 			}
+			std::cout << "The planner ran out of time, use a linear plan for the most probable scene." << std::endl;
 			
-			// Set the waypoint, this is the destination for navigate action and the target for sensing actions.
-			if ("NAVIGATE" == action_name)
+			// The merged scenes share all their facts, so the plan is valid for every scene that was merged.
+			const Scene* most_probable_scene = scenes[0];
+			float highest_probability = -1.0f;
+			for (unsigned int i = 0; i < most_probably_scenes.size(); ++i)
 			{
-				std::vector<std::string> waypoint_list;
-				waypoint_list.push_back(predicate_to_waypoint_mapping[action_parameters[3]]->ontology_id_);
-				set_svalues.request.property_name = "plan:'hasWaypoint'";
-				set_svalues.request.values = waypoint_list;
-				
-				std::cout << "Create the waypoint " << waypoint_list[0] << std::endl;
-				
-				if (!create_sproperty_client_.call(set_svalues))
+				if (scene_probabilities[i] > highest_probability)
 				{
-					std::cerr << "Could not set the waypoint for the action: " << action_instance_name << " " << full_action << std::endl;
-				}
-				else
-				{
-					std::cout << "Set the waypoint to: " << predicate_to_waypoint_mapping[action_parameters[3]]->ontology_id_ << "(" << predicate_to_waypoint_mapping[action_parameters[3]]->ontology_id_ <<")." << std::endl;
+					most_probable_scene = most_probably_scenes[i];
+					highest_probability = scene_probabilities[i];
 				}
 			}
-			else if ("SENSE-VIEW-CONE" == action_name || "OBSERVE-WALL" == action_name || "OBSERVE-WALL-NO-BRANCH" == action_name)
+			fallback_output.reset(new PlanParser(generateFallbackPlan(*most_probable_scene, enter_waypoint, inspection_points, waypoints)));
+			plan_parser = fallback_output.get();
+			continue;
+		}
+		
+		std::cout << "A: " << full_action << std::endl;
+		std::cout << "Processing: " << action_name << std::endl;
+		if ("RAMINIFICATE" == action_name)
+		{
+			std::cout << "Skipping " << action_name << std::endl;
+			continue;
+		}
+		else if ("POP" == action_name)
+		{
+			std::cout << "POP! - stack size " << stack.size() << std::endl;
+			last_added_action = stack[stack.size() - 1];
+			stack.erase(stack.end() - 1);
+			current_branch = FAIL;
+			continue;
+		}
+		
+		// Add the action to the response.
+		const std::vector<std::string>& action_parameters = plan_parser->getParameters();
+		
+		//if ("SENSE" == action_name || "OBSERVE-WALL" == action_name || "SENSE-VIEW-CONE" == action_name)
+		std::string action_class_name;
+		if ("OBSERVE-WALL" == action_name)
+		{
+			action_class_name = "plan:'ObservationAction'";
+		}
+		else
+		{
+			action_class_name = "plan:'PlanAction'";
+		}
+		std::string action_instance_name = ontology_writer.createInstanceLater(action_class_name);
+		std::cout << "Queued an action instance as: " << action_instance_name << std::endl;
+		
+		// Set the properties.
+		ontology_writer.addStringPropertyValue(action_instance_name, "plan:'actionName'", full_action);
+		
+		// Set the waypoint, this is the destination for navigate action and the target for sensing actions.
+		if ("NAVIGATE" == action_name)
+		{
+			const std::string& waypoint_name = predicate_to_waypoint_mapping[action_parameters[3]]->ontology_id_;
+			ontology_writer.addStringPropertyValue(action_instance_name, "plan:'hasWaypoint'", waypoint_name);
+			std::cout << "Set the waypoint to: " << waypoint_name << "." << std::endl;
+		}
+		else if ("SENSE-VIEW-CONE" == action_name || "OBSERVE-WALL" == action_name || "OBSERVE-WALL-NO-BRANCH" == action_name)
+		{
+			std::string view_pose = ("SENSE-VIEW-CONE" == action_name) ? action_parameters[2] : action_parameters[3];
+			std::cerr << "Sense-type action, view-pose=" << view_pose << std::endl;
+			// TODO: Need to extract the targets from the ontology.
+			std::string inspection_point_name;
+			for (std::vector<Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
 			{
-				std::string view_pose = ("SENSE-VIEW-CONE" == action_name) ? action_parameters[2] : action_parameters[3];
-				std::cerr << "Sense-type action, view-pose=" << view_pose << std::endl;
-				// TODO: Need to extract the targets from the ontology.
-				std::string inspection_point_name;
-				for (std::vector<Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
-				{
-					if (view_pose == (*ci)->predicate_)
-					{
-						inspection_point_name = (*ci)->ontology_id_;
-					}
-				}
-				
-				std::vector<std::string> waypoint_list;
-				//waypoint_list.push_back("target");
-				waypoint_list.push_back(inspection_point_name);
-				set_svalues.request.property_name = "plan:'hasWaypoint'";
-				set_svalues.request.values = waypoint_list;
-				if (!create_sproperty_client_.call(set_svalues))
+				if (view_pose == (*ci)->predicate_)
 				{
-					std::cerr << "Could not set the waypoint for the target: " << action_instance_name << " " << full_action << std::endl;
+					inspection_point_name = (*ci)->ontology_id_;
 				}
 			}
-			else if ("OBSERVE-VIEW-CONE" == action_name)
+			
+			ontology_writer.addStringPropertyValue(action_instance_name, "plan:'hasWaypoint'", inspection_point_name);
+		}
+		else if ("OBSERVE-VIEW-CONE" == action_name)
+		{
+			// TODO: Need to extract the targets from the ontology.
+			std::string inspection_point_name;
+			for (std::vector<Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
 			{
-				// TODO: Need to extract the targets from the ontology.
-				std::string inspection_point_name;
-				for (std::vector<Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
-				{
-					if (action_parameters[1] == (*ci)->predicate_)
-					{
-						inspection_point_name = (*ci)->ontology_id_;
-					}
-				}
-				
-				std::vector<std::string> waypoint_list;
-				//waypoint_list.push_back("target");
-				waypoint_list.push_back(inspection_point_name);
-				set_svalues.request.property_name = "plan:'hasWaypoint'";
-				set_svalues.request.values = waypoint_list;
-				if (!create_sproperty_client_.call(set_svalues))
+				if (action_parameters[1] == (*ci)->predicate_)
 				{
-					std::cerr << "Could not set the waypoint for the target: " << action_instance_name << " " << full_action << std::endl;
+					inspection_point_name = (*ci)->ontology_id_;
 				}
 			}
+			
+			ontology_writer.addStringPropertyValue(action_instance_name, "plan:'hasWaypoint'", inspection_point_name);
+		}
 
-			std::vector<std::string> action_list;
-			action_list.push_back(action_instance_name);
-			set_svalues.request.instance_name = last_added_action;
-			set_svalues.request.values = action_list;
-			last_added_action = action_instance_name;
-
-			switch (current_branch)
-			{
-				case FIRST: 
-					res.first_action = action_instance_name;
-					set_svalues.request.property_name = "plan:'hasFirstAction'"; 
-					// Over-write previously set value for instance name
-					set_svalues.request.instance_name = contingent_plan_instance_name;
-					std::cout << "Add hasFirstAction: instance: " << set_svalues.request.instance_name <<
-											"; Property:" << set_svalues.request.property_name << "; Values: " <<
-											set_svalues.request.values[0] << std::endl;
-					break;
-				case NORMAL: 
-					set_svalues.request.property_name = "plan:'hasNextAction'"; 
-					break;
-				case SUCCESS: 
-					set_svalues.request.property_name = "plan:'hasSuccessAction'"; 
-					break;
-				case FAIL: 
-					set_svalues.request.property_name = "plan:'hasFailureAction'"; 
-					break;
-				default: 
-				{
-					std::cout << "IMPOSSIBLE!" << std::endl;
-					return -1;
-				}
-			}
+		std::string previous_instance_name = last_added_action;
+		std::string property_name;
+		last_added_action = action_instance_name;
 
-			if ("OBSERVE-WALL" == action_name)
-			{
-				std::cout << "Branch here!" << std::endl;
-				stack.push_back(action_instance_name);
-				current_branch = SUCCESS;
-			}
-			else
+		switch (current_branch)
+		{
+			case FIRST: 
+				res.first_action = action_instance_name;
+				property_name = "plan:'hasFirstAction'"; 
+				// Over-write previously set value for instance name
+				previous_instance_name = contingent_plan_instance_name;
+				std::cout << "Add hasFirstAction: instance: " << previous_instance_name <<
+										"; Property:" << property_name << "; Values: " <<
+										action_instance_name << std::endl;
+				break;
+			case NORMAL: 
+				property_name = "plan:'hasNextAction'"; 
+				break;
+			case SUCCESS: 
+				property_name = "plan:'hasSuccessAction'"; 
+				break;
+			case FAIL: 
+				property_name = "plan:'hasFailureAction'"; 
+				break;
+			default: 
 			{
-				current_branch = NORMAL;
+				std::cout << "IMPOSSIBLE!" << std::endl;
+				return -1;
 			}
+		}
 
-			if (!create_sproperty_client_.call(set_svalues))
-			{
-				std::cerr << "Could not set the properties for the action: " << last_added_action << std::endl;
-			}
-			//current_pddl_action = next_pddl_action;
+		if ("OBSERVE-WALL" == action_name)
+		{
+			std::cout << "Branch here!" << std::endl;
+			stack.push_back(action_instance_name);
+			current_branch = SUCCESS;
 		}
-		else if (found_first_action)
+		else
 		{
-			break;
+			current_branch = NORMAL;
 		}
+
+		ontology_writer.addStringPropertyValue(previous_instance_name, property_name, action_instance_name);
+		//current_pddl_action = next_pddl_action;
+	}
+	
+	// Let the planner finish its output, it blocks on a full pipe otherwise. Stop it if it is out of time.
+	if (!planner_output.hasTimedOut())
+	{
+		planner_output.skipRemainingOutput();
+	}
+	if (planner_output.hasTimedOut())
+	{
+		planners.stop();
+	}
+	else if (winner != -1)
+	{
+		std::cout << "Found a plan!" << std::endl;
+	}
+	planners.wait();
+	ros::WallTime end_ff = ros::WallTime::now();
+	
+	if (!ontology_writer.flush())
+	{
+		std::cerr << "Could not store the whole plan in the ontology!" << std::endl;
+	}
+	std::cout << "Stored the plan in the ontology with " << ontology_writer.getNumberOfCalls() << " calls for " << ontology_writer.getNumberOfWrites() << " writes." << std::endl;
+	
+	// The first action was queued, so look up the name it got; it keeps its placeholder if it could not be created.
+	if (!res.first_action.empty())
+	{
+		std::string first_action = ontology_writer.getInstanceName(res.first_action);
+		res.first_action = first_action == res.first_action ? "" : first_action;
 	}
 	
 	// Clean the memory.
@@ -839,6 +1062,9 @@ bool CPGenerator::generatePlan(turtlebot_common::GeneratePlan::Request  &req, tu
 	{
 		delete *ci;
 	}
+	
+	// The rotation matrices of the waypoints are not referred to anymore.
+	Waypoint::getOntologyWriter().forgetInstanceNames();
 
 	// Record plan generation statistics
 	ros::WallTime end_gen_plan = ros::WallTime::now();
@@ -875,16 +1101,222 @@ bool CPGenerator::getFaceCoordinates(turtlebot_common::GetFaceCoordinates::Reque
 	return false;
 }
 
+/**
+ * Calculate the maximum number of nested observe-wall actions a plan can need. Only walls that are 
+ * present in some, but not all, of the scenes can split a belief state and every split settles at 
+ * least one of them. The depth is therefore bounded by the number of such walls and by the number 
+ * of scenes - 1.
+ * @param scenes The scenes that make up the initial belief state.
+ * @param max_depth The depth of the fixed chain of one level per face and view point, the result is never larger.
+ * @return The number of levels the stack needs beyond l0.
+ */
+static unsigned int getBranchingDepth(const std::vector<Scene*>& scenes, unsigned int max_depth)
+{
+	std::map<const Face*, unsigned int> nr_scenes_with_face;
+	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci)
+	{
+		const Scene* scene = *ci;
+		std::set<const Face*> scene_faces;
+		for (std::vector<Shape*>::const_iterator ci = scene->getShapes().begin(); ci != scene->getShapes().end(); ++ci)
+		{
+			const Shape* shape = *ci;
+			scene_faces.insert(shape->getFaces().begin(), shape->getFaces().end());
+		}
+		
+		for (std::set<const Face*>::const_iterator ci = scene_faces.begin(); ci != scene_faces.end(); ++ci)
+		{
+			++nr_scenes_with_face[*ci];
+		}
+	}
+	
+	unsigned int depth = 0;
+	for (std::map<const Face*, unsigned int>::const_iterator ci = nr_scenes_with_face.begin(); ci != nr_scenes_with_face.end(); ++ci)
+	{
+		if ((*ci).second < scenes.size())
+		{
+			++depth;
+		}
+	}
+	
+	if (!scenes.empty() && depth > scenes.size() - 1)
+	{
+		depth = scenes.size() - 1;
+	}
+	if (depth > max_depth)
+	{
+		depth = max_depth;
+	}
+	return depth;
+}
+
+/**
+ * The facts of a single scene (canTraverse, visibleFrom, hasWall and canObserve), see @ref{generateSceneFacts}.
+ * Every fact is a line without its last argument, the state, which is added by @ref{writeSceneFacts}; this way
+ * the facts of two scenes can be compared, and they can be written for any state number.
+ */
+struct SceneFactsTask
+{
+	const Scene* scene_;
+	const std::vector<Waypoint*>* waypoints_;
+	const std::vector<Vector2D>* view_points_;
+	std::string facts_;
+};
+
+/**
+ * The facts of the scenes that remain after @ref{mergeIndistinguishableScenes}, in the same order, such that
+ * generateProblemFile writes them without computing them again.
+ */
+static std::vector<SceneFactsTask> merged_scene_facts;
+
+/**
+ * Write the facts of @ref{task}'s scene to its buffer. This only reads the scene, the waypoints and the faces,
+ * so multiple tasks can run at the same time.
+ */
+static void generateSceneFacts(SceneFactsTask& task)
+{
+	const Scene* scene = task.scene_;
+	const std::vector<Waypoint*>& waypoints = *task.waypoints_;
+	const std::vector<Vector2D>& view_points = *task.view_points_;
+	std::stringstream o;
+	
+	// Connect the waypoints given this scene.
+	// * canTraverse
+	for (unsigned int i = 0; i < waypoints.size(); ++i)
+	{
+		const Waypoint* waypoint = waypoints[i];
+		unsigned int view_point_id = 0;
+		for (std::vector<Vector2D>::const_iterator ci = view_points.begin(); ci != view_points.end(); ++ci)
+		{
+			if (scene->canConnect(*ci, Vector2D(waypoint->x_, waypoint->y_)))
+			{
+				o << "(visibleFrom view_target" << view_point_id << " " << waypoint->predicate_ << std::endl;
+			}
+			++view_point_id;
+		}
+		
+		for (unsigned int j = i + 1; j < waypoints.size(); ++j)
+		{
+			const Waypoint* other_waypoint = waypoints[j];
+			
+			if (waypoint == other_waypoint) continue;
+			
+			if (scene->canConnect(Vector2D(waypoint->x_, waypoint->y_), Vector2D(other_waypoint->x_, other_waypoint->y_)))
+			{
+				o << "(canTraverse turtlebot " << other_waypoint->predicate_ << " " << waypoint->predicate_ << std::endl;
+				o << "(canTraverse turtlebot " << waypoint->predicate_ << " " << other_waypoint->predicate_ << std::endl;
+			}
+		}
+	}
+	
+	// Now process all the shapes and faces for each scene and record these in the planning problem.
+	// * hasWall
+	// * canSee
+	for (std::vector<Shape*>::const_iterator ci = scene->getShapes().begin(); ci != scene->getShapes().end(); ++ci)
+	{
+		Shape* shape = *ci;
+		for (std::vector<const Face*>::const_iterator ci = shape->getFaces().begin(); ci != shape->getFaces().end(); ++ci)
+		{
+			const Face* face = *ci;
+			o << "(hasWall " << face->getPDDLName() << std::endl;
+		}
+	}
+	
+	// All the faces are tested from one waypoint at a time, such that a single sweep answers every line of sight.
+	std::vector<const Face*> faces(Face::getFaces().begin(), Face::getFaces().end());
+	std::vector<std::vector<bool> > is_visible(waypoints.size());
+	for (unsigned int i = 0; i < waypoints.size(); ++i)
+	{
+		scene->canSee(faces, Vector2D(waypoints[i]->x_, waypoints[i]->y_), is_visible[i]);
+	}
+	
+	for (unsigned int face_nr = 0; face_nr < faces.size(); ++face_nr)
+	{
+		const Face* face = faces[face_nr];
+		bool is_in_scene = scene->getFace(face->getPDDLName()) != NULL;
+		for (unsigned int i = 0; i < waypoints.size(); ++i)
+		{
+			if (is_visible[i][face_nr] || !is_in_scene)
+			{
+				o << "(canObserve " << face->getPDDLName() << " " << waypoints[i]->predicate_ << std::endl;
+			}
+		}
+	}
+	task.facts_ = o.str();
+}
+
+/**
+ * Write the facts of a scene, see @ref{SceneFactsTask}, as the facts of state @ref{scene_nr}.
+ */
+static void writeSceneFacts(std::ostream& o, const std::string& facts, unsigned int scene_nr)
+{
+	std::string::size_type begin = 0;
+	std::string::size_type end;
+	while ((end = facts.find('\n', begin)) != std::string::npos)
+	{
+		o.write(facts.data() + begin, end - begin);
+		o << " s" << scene_nr << ")" << std::endl;
+		begin = end + 1;
+	}
+}
+
+/**
+ * Merge the scenes that have exactly the same facts (canTraverse, visibleFrom, hasWall and canObserve). Every face
+ * of a scene is part of its facts, so in practice only scenes with the same shapes are merged, e.g. scenes of the
+ * ontology that differ in objects that have no faces, or only in their probability. Encoding each of them as a
+ * separate state only makes the problem bigger. The first scene of every group is kept and its facts are stored in
+ * @ref{merged_scene_facts}.
+ * @param scenes The scenes to merge, only the first scene of every group remains.
+ * @param probabilities For every remaining scene the sum of the probabilities of its group will be stored here.
+ * @param waypoints All the waypoints of the planning problem.
+ * @param view_points All the view points of the planning problem.
+ */
+static void mergeIndistinguishableScenes(std::vector<Scene*>& scenes, std::vector<float>& probabilities, const std::vector<Waypoint*>& waypoints, const std::vector<Vector2D>& view_points)
+{
+	std::vector<SceneFactsTask> tasks(scenes.size());
+	for (unsigned int i = 0; i < scenes.size(); ++i)
+	{
+		tasks[i].scene_ = scenes[i];
+		tasks[i].waypoints_ = &waypoints;
+		tasks[i].view_points_ = &view_points;
+	}
+	runTasks(tasks, generateSceneFacts);
+	
+	std::map<std::string, unsigned int> signature_to_scene;
+	std::vector<Scene*> merged_scenes;
+	probabilities.clear();
+	merged_scene_facts.clear();
+	for (unsigned int i = 0; i < scenes.size(); ++i)
+	{
+		std::map<std::string, unsigned int>::iterator mapping_i = signature_to_scene.find(tasks[i].facts_);
+		if (mapping_i == signature_to_scene.end())
+		{
+			signature_to_scene[tasks[i].facts_] = merged_scenes.size();
+			merged_scenes.push_back(scenes[i]);
+			probabilities.push_back(scenes[i]->getProbability());
+			merged_scene_facts.push_back(tasks[i]);
+		}
+		else
+		{
+			std::cout << "Merge scene " << scenes[i]->getName() << " with " << merged_scenes[(*mapping_i).second]->getName() << ", the planner cannot distinguish them." << std::endl;
+			probabilities[(*mapping_i).second] += scenes[i]->getProbability();
+		}
+	}
+	std::cout << "Merged " << scenes.size() << " scenes into " << merged_scenes.size() << " states." << std::endl;
+	scenes.swap(merged_scenes);
+}
+
 void CPGenerator::generateProblemFile(std::ofstream& o, const std::vector<Waypoint*>& inspection_points, const std::vector<Waypoint*>& waypoints, const Waypoint& enter, const Waypoint& exit, const std::vector<Vector2D>& view_points, const std::vector<const Face*>& faces, const std::vector<Scene*>& scenes)
 {
 	//unsigned int nr_states = inspection_points.size() * scenes.size();
 	unsigned int nr_states = scenes.size();
 	std::cout << "Number of states is: " << nr_states << std::endl;
+	unsigned int nr_levels = getBranchingDepth(scenes, faces.size() + view_points.size() + 1) + 1;
+	std::cout << "Number of levels is: " << nr_levels << std::endl;
 	o << "(define (problem Mars-3)" << std::endl;
 	o << "(:domain Mars)" << std::endl;
 	o << "(:objects" << std::endl;
 	
-	for (unsigned int i = 0; i < faces.size() + view_points.size() + 2; ++i)
+	for (unsigned int i = 0; i < nr_levels; ++i)
 	{
 		o << "l" << i << " - LEVEL" << std::endl;
 	}
@@ -903,8 +1335,7 @@ void CPGenerator::generateProblemFile(std::ofstream& o, const std::vector<Waypoi
 	o << " (resolve-axioms)" << std::endl;
 	o << " (lev l0)" << std::endl;
 	
-	// NOTE: Temporary 'fix' to make the planning process quicker.
-	for (unsigned int i = 0; i < faces.size() + view_points.size() + 1; ++i)
+	for (unsigned int i = 0; i + 1 < nr_levels; ++i)
 	{
 		o << "(next l" << i << " l" << (i + 1) << ")" << std::endl;
 	}
@@ -920,82 +1351,45 @@ void CPGenerator::generateProblemFile(std::ofstream& o, const std::vector<Waypoi
 		o << "(isViewCone " << (*ci)->predicate_ << ")" << std::endl;
 	}
 	
-	// Process the scenes and store all the faces (and their relationship to the scenes) in here.
-	std::vector<Face*> processed_faces;
-	unsigned int scene_nr = 0;
-	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci, ++scene_nr)
+	// Validate the waypoints before the scenes are processed in parallel.
+	for (unsigned int i = 0; i < waypoints.size(); ++i)
 	{
-		const Scene* scene = *ci;
-		
-		// Connect the waypoints given this scene.
-		// * canTraverse
-		//for (std::vector<Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
-		for (unsigned int i = 0; i < waypoints.size(); ++i)
-		{
-			const Waypoint* waypoint = waypoints[i];
-			unsigned int view_point_id = 0;
-			for (std::vector<Vector2D>::const_iterator ci = view_points.begin(); ci != view_points.end(); ++ci)
-			{
-				if (scene->canConnect(*ci, Vector2D(waypoint->x_, waypoint->y_)))
-				{
-					o << "(visibleFrom view_target" << view_point_id << " " << waypoint->predicate_ << " s" << scene_nr << ")" << std::endl;
-				}
-				++view_point_id;
-			}
-			
-			//for (std::vector<std::pair<float, Waypoint*> >::const_iterator ci = waypoint->edges_.begin(); ci != waypoint->edges_.end(); ++ci)
-			//for (std::vector<Waypoint*>::const_iterator ci2 = waypoints.begin(); ci2 != waypoints.end(); ++ci2)
-			for (unsigned int j = i + 1; j < waypoints.size(); ++j)
-			{
-				const Waypoint* other_waypoint = waypoints[j];
-				
-				if (waypoint == other_waypoint) continue;
-				
-				if (waypoint->predicate_ == other_waypoint->predicate_)
-				{
-					std::cerr << "Waypoints cannot have the same predicate!" << std::endl;
-					::exit(1);
-				}
-				
-				if (scene->canConnect(Vector2D(waypoint->x_, waypoint->y_), Vector2D(other_waypoint->x_, other_waypoint->y_)))
-				{
-					//std::cout << waypoint->predicate_ << " is connected to " << other_waypoint->predicate_ << std::endl;
-					o << "(canTraverse turtlebot " << other_waypoint->predicate_ << " " << waypoint->predicate_ <<  " s" << scene_nr << ")" << std::endl;
-					o << "(canTraverse turtlebot " << waypoint->predicate_ << " " << other_waypoint->predicate_ <<  " s" << scene_nr << ")" << std::endl;
-				}
-			}
-		}
-		
-		// Now process all the shapes and faces for each scene and record these in the planning problem.
-		// * hasWall
-		// * canSee
-		for (std::vector<Shape*>::const_iterator ci = scene->getShapes().begin(); ci != scene->getShapes().end(); ++ci)
+		for (unsigned int j = i + 1; j < waypoints.size(); ++j)
 		{
-			Shape* shape = *ci;
-			for (std::vector<const Face*>::const_iterator ci = shape->getFaces().begin(); ci != shape->getFaces().end(); ++ci)
+			if (waypoints[i] != waypoints[j] && waypoints[i]->predicate_ == waypoints[j]->predicate_)
 			{
-				const Face* face = *ci;
-				o << "(hasWall " << face->getPDDLName() << " s" << scene_nr << ")" << std::endl;
+				std::cerr << "Waypoints cannot have the same predicate!" << std::endl;
+				::exit(1);
 			}
 		}
-		
-		for (std::vector<Face*>::const_iterator ci = Face::getFaces().begin(); ci != Face::getFaces().end(); ++ci)
+	}
+	
+	// Every scene writes its facts to its own buffer, the buffers are emitted in scene order afterwards
+	// so the problem file does not depend on the number of threads. The facts of the merged scenes have
+	// been computed already.
+	std::vector<SceneFactsTask> tasks;
+	tasks.swap(merged_scene_facts);
+	bool is_computed = tasks.size() == scenes.size();
+	for (unsigned int scene_nr = 0; is_computed && scene_nr < scenes.size(); ++scene_nr)
+	{
+		is_computed = tasks[scene_nr].scene_ == scenes[scene_nr] && tasks[scene_nr].waypoints_ == &waypoints && tasks[scene_nr].view_points_ == &view_points;
+	}
+	if (!is_computed)
+	{
+		tasks.resize(scenes.size());
+		for (unsigned int scene_nr = 0; scene_nr < scenes.size(); ++scene_nr)
 		{
-			const Face* face = *ci;
-			for (std::vector<Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
-			{
-				const Waypoint* waypoint = *ci;
-				if (scene->canSee(*face, Vector2D(waypoint->x_, waypoint->y_)) ||
-				    scene->getFace(face->getPDDLName()) == NULL)
-				{
-					//for (unsigned int state_nr = 0; state_nr < scenes.size(); ++state_nr)
-					{
-						//o << "(canObserve " << face->getPDDLName() << " " << waypoint->predicate_ << " s" << state_nr << ")" << std::endl;
-						o << "(canObserve " << face->getPDDLName() << " " << waypoint->predicate_ << " s" << scene_nr << ")" << std::endl;
-					}
-				}
-			}
+			tasks[scene_nr].scene_ = scenes[scene_nr];
+			tasks[scene_nr].waypoints_ = &waypoints;
+			tasks[scene_nr].view_points_ = &view_points;
 		}
+		runTasks(tasks, generateSceneFacts);
+	}
+	std::cout << "Line segment tests against shapes (cached results): " << Scene::getShapeQueryCache().getNumberOfTests() << " (" << Scene::getShapeQueryCache().getNumberOfCachedResults() << ")" << std::endl;
+	
+	for (unsigned int scene_nr = 0; scene_nr < tasks.size(); ++scene_nr)
+	{
+		writeSceneFacts(o, tasks[scene_nr].facts_, scene_nr);
 	}
 
 	o << " )" << std::endl;
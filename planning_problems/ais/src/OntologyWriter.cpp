@@ -0,0 +1,237 @@
+#include "OntologyWriter.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+OntologyWriter::OntologyWriter()
+	: nr_queued_instances_(0), nr_calls_(0), nr_writes_(0)
+{
+	
+}
+
+OntologyWriter::~OntologyWriter()
+{
+	if (!writes_.empty())
+	{
+		std::cerr << "[OntologyWriter::~OntologyWriter] " << writes_.size() << " writes were never flushed." << std::endl;
+	}
+}
+
+std::string OntologyWriter::createInstance(const std::string& class_name)
+{
+	std::string instance_name;
+	++nr_calls_;
+	++nr_writes_;
+	if (!doCreateInstance(class_name, instance_name))
+	{
+		std::cerr << "[OntologyWriter::createInstance] Failed to create an instance of " << class_name << "." << std::endl;
+		return "";
+	}
+	return instance_name;
+}
+
+std::string OntologyWriter::createInstanceLater(const std::string& class_name)
+{
+	// No instance name contains a space.
+	std::stringstream ss;
+	ss << "queued instance " << nr_queued_instances_;
+	++nr_queued_instances_;
+	queue(CREATE_INSTANCE, ss.str(), "").string_values_.push_back(class_name);
+	return ss.str();
+}
+
+std::string OntologyWriter::getInstanceName(const std::string& name) const
+{
+	std::map<std::string, std::string>::const_iterator ci = instance_names_.find(name);
+	return ci == instance_names_.end() ? name : (*ci).second;
+}
+
+void OntologyWriter::forgetInstanceNames()
+{
+	instance_names_.clear();
+}
+
+void OntologyWriter::setFloatProperty(const std::string& instance_name, const std::string& property_name, float value)
+{
+	queue(SET_FLOAT, instance_name, property_name).float_value_ = value;
+}
+
+void OntologyWriter::setStringProperty(const std::string& instance_name, const std::string& property_name, const std::string& value)
+{
+	queue(SET_STRING, instance_name, property_name).string_values_.push_back(value);
+}
+
+void OntologyWriter::addStringPropertyValue(const std::string& instance_name, const std::string& property_name, const std::string& value)
+{
+	std::map<std::pair<std::string, std::string>, unsigned int>::const_iterator ci = pending_adds_.find(std::make_pair(instance_name, property_name));
+	if (ci != pending_adds_.end())
+	{
+		++nr_writes_;
+		writes_[(*ci).second].string_values_.push_back(value);
+		return;
+	}
+	
+	queue(ADD_STRINGS, instance_name, property_name).string_values_.push_back(value);
+	pending_adds_[std::make_pair(instance_name, property_name)] = writes_.size() - 1;
+}
+
+OntologyWriter::Write& OntologyWriter::queue(WRITE_TYPE type, const std::string& instance_name, const std::string& property_name)
+{
+	// Values added before a set must not be merged with values added after it.
+	if (type != ADD_STRINGS)
+	{
+		pending_adds_.erase(std::make_pair(instance_name, property_name));
+	}
+	
+	++nr_writes_;
+	writes_.push_back(Write());
+	Write& write = writes_.back();
+	write.type_ = type;
+	write.instance_name_ = instance_name;
+	write.property_name_ = property_name;
+	write.float_value_ = 0;
+	return write;
+}
+
+bool OntologyWriter::flush()
+{
+	bool success = true;
+	std::set<std::string> failed_instances; // The placeholders of the queued instances that could not be created.
+	for (std::vector<Write>::const_iterator ci = writes_.begin(); ci != writes_.end(); ++ci)
+	{
+		const Write& write = *ci;
+		bool written = false;
+		
+		// Do not write about an instance that does not exist, or the placeholder would be stored in the ontology.
+		bool refers_to_failed_instance = failed_instances.count(write.instance_name_) != 0;
+		for (std::vector<std::string>::const_iterator ci = write.string_values_.begin(); ci != write.string_values_.end() && write.type_ != CREATE_INSTANCE; ++ci)
+		{
+			refers_to_failed_instance = refers_to_failed_instance || failed_instances.count(*ci) != 0;
+		}
+		if (refers_to_failed_instance)
+		{
+			std::cerr << "[OntologyWriter::flush] Skip " << write.property_name_ << " of " << write.instance_name_ << ", an instance it refers to could not be created." << std::endl;
+			success = false;
+			continue;
+		}
+		++nr_calls_;
+		
+		std::string instance_name = getInstanceName(write.instance_name_);
+		std::vector<std::string> values;
+		for (std::vector<std::string>::const_iterator ci = write.string_values_.begin(); ci != write.string_values_.end(); ++ci)
+		{
+			values.push_back(getInstanceName(*ci));
+		}
+		
+		switch (write.type_)
+		{
+			case CREATE_INSTANCE:
+			{
+				std::string created_instance_name;
+				written = doCreateInstance(values[0], created_instance_name);
+				if (written)
+				{
+					instance_names_[write.instance_name_] = created_instance_name;
+				}
+				else
+				{
+					failed_instances.insert(write.instance_name_);
+				}
+				break;
+			}
+			case SET_FLOAT:
+				written = doSetFloatProperty(instance_name, write.property_name_, write.float_value_);
+				break;
+			case SET_STRING:
+				written = doSetStringProperty(instance_name, write.property_name_, values[0]);
+				break;
+			case ADD_STRINGS:
+				written = doAddStringPropertyValues(instance_name, write.property_name_, values);
+				break;
+		}
+		
+		if (!written)
+		{
+			std::cerr << "[OntologyWriter::flush] Could not write " << write.property_name_ << " of " << write.instance_name_ << "." << std::endl;
+			success = false;
+		}
+	}
+	writes_.clear();
+	pending_adds_.clear();
+	return success;
+}
+
+void OntologyWriter::discard()
+{
+	for (std::vector<Write>::const_iterator ci = writes_.begin(); ci != writes_.end(); ++ci)
+	{
+		nr_writes_ -= (*ci).type_ == ADD_STRINGS ? (*ci).string_values_.size() : 1;
+	}
+	writes_.clear();
+	pending_adds_.clear();
+}
+
+LocalOntologyWriter::LocalOntologyWriter()
+	: nr_instances_(0)
+{
+	
+}
+
+std::string LocalOntologyWriter::getClass(const std::string& instance_name) const
+{
+	std::map<std::string, std::string>::const_iterator ci = classes_.find(instance_name);
+	return ci == classes_.end() ? "" : (*ci).second;
+}
+
+std::vector<std::string> LocalOntologyWriter::getStringProperty(const std::string& instance_name, const std::string& property_name) const
+{
+	std::map<Property, std::vector<std::string> >::const_iterator ci = string_properties_.find(Property(instance_name, property_name));
+	return ci == string_properties_.end() ? std::vector<std::string>() : (*ci).second;
+}
+
+bool LocalOntologyWriter::getFloatProperty(const std::string& instance_name, const std::string& property_name, float& value) const
+{
+	std::map<Property, float>::const_iterator ci = float_properties_.find(Property(instance_name, property_name));
+	if (ci == float_properties_.end())
+	{
+		return false;
+	}
+	value = (*ci).second;
+	return true;
+}
+
+bool LocalOntologyWriter::doCreateInstance(const std::string& class_name, std::string& instance_name)
+{
+	// Name the instance like the ontology does: the local name of the class (e.g. Pose2D for plan:'Pose2D') and a number.
+	std::string local_name = class_name.substr(class_name.find(':') + 1);
+	local_name.erase(std::remove(local_name.begin(), local_name.end(), '\''), local_name.end());
+	
+	std::stringstream ss;
+	ss << "local#" << local_name << "_" << nr_instances_;
+	++nr_instances_;
+	instance_name = ss.str();
+	classes_[instance_name] = class_name;
+	return true;
+}
+
+bool LocalOntologyWriter::doSetFloatProperty(const std::string& instance_name, const std::string& property_name, float value)
+{
+	float_properties_[Property(instance_name, property_name)] = value;
+	return true;
+}
+
+bool LocalOntologyWriter::doSetStringProperty(const std::string& instance_name, const std::string& property_name, const std::string& value)
+{
+	std::vector<std::string>& values = string_properties_[Property(instance_name, property_name)];
+	values.clear();
+	values.push_back(value);
+	return true;
+}
+
+bool LocalOntologyWriter::doAddStringPropertyValues(const std::string& instance_name, const std::string& property_name, const std::vector<std::string>& values)
+{
+	std::vector<std::string>& existing_values = string_properties_[Property(instance_name, property_name)];
+	existing_values.insert(existing_values.end(), values.begin(), values.end());
+	return true;
+}
@@ -0,0 +1,166 @@
+#ifndef FLYING_TURTLEBOT_PLANNING_ONTOLOGY_WRITER_H
+#define FLYING_TURTLEBOT_PLANNING_ONTOLOGY_WRITER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+/**
+ * Writes instances and their properties to the ontology. All the property writes are queued and done by
+ * @ref{flush}. Instances can be created immediately, if their name is needed, or be queued as well. The writes can
+ * therefore be delayed to a moment the caller would otherwise wait (e.g. while the planner runs).
+ *
+ * This does not make fewer calls: the ontology has no service to write many instances or properties at once, so
+ * every queued write is still a call of its own. Only values that are added to the same property of the same
+ * instance are written in a single call, which the waypoints and plans hardly do.
+ */
+class OntologyWriter
+{
+public:
+	OntologyWriter();
+	
+	virtual ~OntologyWriter();
+	
+	/**
+	 * Create an instance, this is not queued.
+	 * @param class_name The class of the instance, e.g. "plan:'Pose2D'".
+	 * @return The name of the new instance, or an empty string if it could not be created.
+	 */
+	std::string createInstance(const std::string& class_name);
+	
+	/**
+	 * Queue the creation of an instance.
+	 * @param class_name The class of the instance, e.g. "plan:'Pose2D'".
+	 * @return A name that stands for the instance in the queued writes (as instance or as value), see
+	 * @ref{getInstanceName}.
+	 */
+	std::string createInstanceLater(const std::string& class_name);
+	
+	/**
+	 * @return The name of an instance created by @ref{createInstanceLater}, once it has been flushed. Other names
+	 * are returned unchanged.
+	 */
+	std::string getInstanceName(const std::string& name) const;
+	
+	/**
+	 * Forget the names of the instances created by @ref{createInstanceLater} that have been flushed, e.g. once the
+	 * objects that refer to them are deleted. @ref{getInstanceName} returns their placeholders unchanged afterwards.
+	 */
+	void forgetInstanceNames();
+	
+	/**
+	 * Queue setting the (only) value of a float property.
+	 */
+	void setFloatProperty(const std::string& instance_name, const std::string& property_name, float value);
+	
+	/**
+	 * Queue setting the (only) value of a string property.
+	 */
+	void setStringProperty(const std::string& instance_name, const std::string& property_name, const std::string& value);
+	
+	/**
+	 * Queue adding a value to a string property, the existing values are kept.
+	 */
+	void addStringPropertyValue(const std::string& instance_name, const std::string& property_name, const std::string& value);
+	
+	/**
+	 * Perform all the queued writes, in the order they were queued. If a queued instance cannot be created, the
+	 * writes that refer to it (as instance or as value) are skipped, so its placeholder never reaches the ontology.
+	 * @return True if all the writes succeeded.
+	 */
+	bool flush();
+	
+	/**
+	 * Drop all the queued writes, e.g. those of a plan that turned out to be incomplete. Instances that were created
+	 * immediately are kept.
+	 */
+	void discard();
+	
+	/**
+	 * @return The number of calls that have been made to the ontology (see @ref{getNumberOfWrites}).
+	 */
+	unsigned int getNumberOfCalls() const { return nr_calls_; }
+	
+	/**
+	 * @return The number of instances and values that have been written. This only differs from
+	 * @ref{getNumberOfCalls} by the values that were added to the same property together.
+	 */
+	unsigned int getNumberOfWrites() const { return nr_writes_; }
+	
+protected:
+	/**
+	 * The actual calls to the ontology.
+	 */
+	virtual bool doCreateInstance(const std::string& class_name, std::string& instance_name) = 0;
+	virtual bool doSetFloatProperty(const std::string& instance_name, const std::string& property_name, float value) = 0;
+	virtual bool doSetStringProperty(const std::string& instance_name, const std::string& property_name, const std::string& value) = 0;
+	virtual bool doAddStringPropertyValues(const std::string& instance_name, const std::string& property_name, const std::vector<std::string>& values) = 0;
+	
+private:
+	enum WRITE_TYPE { CREATE_INSTANCE, SET_FLOAT, SET_STRING, ADD_STRINGS };
+	
+	struct Write
+	{
+		WRITE_TYPE type_;
+		std::string instance_name_;
+		std::string property_name_;
+		float float_value_;
+		std::vector<std::string> string_values_; // For CREATE_INSTANCE: the class.
+	};
+	
+	Write& queue(WRITE_TYPE type, const std::string& instance_name, const std::string& property_name);
+	
+	std::vector<Write> writes_;
+	
+	// The queued ADD_STRINGS write of every instance and property, new values are merged into it.
+	std::map<std::pair<std::string, std::string>, unsigned int> pending_adds_;
+	
+	// The names of the instances created by createInstanceLater, by the name that stands for them.
+	std::map<std::string, std::string> instance_names_;
+	unsigned int nr_queued_instances_;
+	
+	unsigned int nr_calls_;
+	unsigned int nr_writes_;
+};
+
+/**
+ * A stand-in for the ontology that stores everything in memory, e.g. to test without ROS.
+ */
+class LocalOntologyWriter : public OntologyWriter
+{
+public:
+	LocalOntologyWriter();
+	
+	/**
+	 * @return The class of @ref{instance_name}, or an empty string if it does not exist.
+	 */
+	std::string getClass(const std::string& instance_name) const;
+	
+	/**
+	 * @return All the values of a string property, in the order they were written.
+	 */
+	std::vector<std::string> getStringProperty(const std::string& instance_name, const std::string& property_name) const;
+	
+	/**
+	 * @param value The value will be stored here.
+	 * @return True if the float property has a value.
+	 */
+	bool getFloatProperty(const std::string& instance_name, const std::string& property_name, float& value) const;
+	
+protected:
+	bool doCreateInstance(const std::string& class_name, std::string& instance_name);
+	bool doSetFloatProperty(const std::string& instance_name, const std::string& property_name, float value);
+	bool doSetStringProperty(const std::string& instance_name, const std::string& property_name, const std::string& value);
+	bool doAddStringPropertyValues(const std::string& instance_name, const std::string& property_name, const std::vector<std::string>& values);
+	
+private:
+	typedef std::pair<std::string, std::string> Property;
+	
+	unsigned int nr_instances_;
+	std::map<std::string, std::string> classes_;
+	std::map<Property, float> float_properties_;
+	std::map<Property, std::vector<std::string> > string_properties_;
+};
+
+#endif
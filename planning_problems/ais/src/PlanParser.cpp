@@ -0,0 +1,234 @@
+#include "PlanParser.h"
+
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+PlanParser::PlanParser(int fd, FILE* echo)
+	: fd_(fd), echo_(echo), buffer_(1 << 16), begin_(0), end_(0), found_first_action_(false), has_ended_(false), has_time_limit_(false), has_timed_out_(false), plan_search_begin_(0)
+{
+	
+}
+
+PlanParser::PlanParser(const std::string& output)
+	: fd_(-1), echo_(NULL), buffer_(output.begin(), output.end()), begin_(0), end_(output.size()), found_first_action_(false), has_ended_(false), has_time_limit_(false), has_timed_out_(false), plan_search_begin_(0)
+{
+	// Keep room for a byte, such that the buffer is never empty.
+	buffer_.push_back('\0');
+}
+
+void PlanParser::setTimeLimit(float seconds)
+{
+	clock_gettime(CLOCK_MONOTONIC, &deadline_);
+	if (seconds > 0)
+	{
+		long nanoseconds = deadline_.tv_nsec + (long)((seconds - (long)seconds) * 1e9);
+		deadline_.tv_sec += (long)seconds + nanoseconds / 1000000000;
+		deadline_.tv_nsec = nanoseconds % 1000000000;
+	}
+	has_time_limit_ = true;
+}
+
+int PlanParser::getRemainingTime() const
+{
+	if (!has_time_limit_)
+	{
+		return -1;
+	}
+	
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	long remaining_time = (deadline_.tv_sec - now.tv_sec) * 1000 + (deadline_.tv_nsec - now.tv_nsec) / 1000000;
+	return remaining_time > 0 ? remaining_time : 0;
+}
+
+bool PlanParser::readAvailable()
+{
+	if (end_ == buffer_.size())
+	{
+		buffer_.resize(buffer_.size() * 2);
+	}
+	return readBlock();
+}
+
+bool PlanParser::hasPlanStarted()
+{
+	static const char* FIRST_STEP = "step    0:";
+	const char* begin = &buffer_[0] + std::min(std::max(begin_, plan_search_begin_), end_);
+	const char* end = &buffer_[0] + end_;
+	bool found = std::search(begin, end, FIRST_STEP, FIRST_STEP + strlen(FIRST_STEP)) != end;
+	
+	// The next search only needs to include the part of the buffer that could complete a match.
+	if (end_ > strlen(FIRST_STEP))
+	{
+		plan_search_begin_ = end_ - strlen(FIRST_STEP);
+	}
+	return found;
+}
+
+void PlanParser::setEcho(FILE* echo)
+{
+	echo_ = echo;
+	if (echo_ != NULL && end_ > begin_)
+	{
+		fwrite(&buffer_[0] + begin_, 1, end_ - begin_, echo_);
+		fflush(echo_);
+	}
+}
+
+bool PlanParser::getNextAction(std::string& full_action, std::string& action_name)
+{
+	const char* line;
+	size_t length;
+	while (!has_ended_ && getLine(line, length))
+	{
+		if (!found_first_action_)
+		{
+			static const char* FIRST_STEP = "step    0:";
+			size_t first_step_length = strlen(FIRST_STEP);
+			for (size_t i = 0; i + first_step_length <= length && !found_first_action_; ++i)
+			{
+				found_first_action_ = memcmp(line + i, FIRST_STEP, first_step_length) == 0;
+			}
+			if (!found_first_action_) continue;
+		}
+		
+		const char* colon = static_cast<const char*>(memchr(line, ':', length));
+		if (colon == NULL)
+		{
+			has_ended_ = true;
+			break;
+		}
+		
+		// The action starts after ": ".
+		const char* action = colon + 2;
+		if (action >= line + length)
+		{
+			continue;
+		}
+		full_action.assign(action, line + length);
+		
+		parameters_.clear();
+		const char* token = action;
+		while (token < line + length)
+		{
+			const char* token_end = static_cast<const char*>(memchr(token, ' ', line + length - token));
+			if (token_end == NULL)
+			{
+				token_end = line + length;
+			}
+			if (token_end != token)
+			{
+				parameters_.push_back(std::string(token, token_end));
+			}
+			token = token_end + 1;
+		}
+		
+		const char* name_end = static_cast<const char*>(memchr(action, ' ', line + length - action));
+		action_name.assign(action, name_end == NULL ? line + length : name_end);
+		return true;
+	}
+	has_ended_ = true;
+	return false;
+}
+
+void PlanParser::skipRemainingOutput()
+{
+	begin_ = end_ = 0;
+	while (read())
+	{
+		begin_ = end_ = 0;
+	}
+}
+
+bool PlanParser::getLine(const char*& line, size_t& length)
+{
+	while (true)
+	{
+		const char* begin = &buffer_[0] + begin_;
+		const char* new_line = static_cast<const char*>(memchr(begin, '\n', end_ - begin_));
+		if (new_line != NULL)
+		{
+			line = begin;
+			length = new_line - begin;
+			begin_ += length + 1;
+			return true;
+		}
+		
+		// Move the incomplete line to the front, and make room if it fills the whole buffer.
+		if (begin_ > 0)
+		{
+			memmove(&buffer_[0], begin, end_ - begin_);
+			end_ -= begin_;
+			begin_ = 0;
+		}
+		if (end_ == buffer_.size())
+		{
+			buffer_.resize(buffer_.size() * 2);
+		}
+		
+		// An incomplete last line is ignored.
+		if (!read())
+		{
+			return false;
+		}
+	}
+}
+
+bool PlanParser::read()
+{
+	if (fd_ < 0)
+	{
+		return false;
+	}
+	
+	while (has_time_limit_)
+	{
+		int timeout = getRemainingTime();
+		if (timeout == 0)
+		{
+			has_timed_out_ = true;
+			return false;
+		}
+		
+		struct pollfd poll_fd;
+		poll_fd.fd = fd_;
+		poll_fd.events = POLLIN;
+		int result = poll(&poll_fd, 1, timeout);
+		if (result > 0 || (result < 0 && errno != EINTR))
+		{
+			break;
+		}
+	}
+	return readBlock();
+}
+
+bool PlanParser::readBlock()
+{
+	if (fd_ < 0)
+	{
+		return false;
+	}
+	
+	ssize_t nr_bytes;
+	do
+	{
+		nr_bytes = ::read(fd_, &buffer_[0] + end_, buffer_.size() - end_);
+	}
+	while (nr_bytes < 0 && errno == EINTR);
+	
+	if (nr_bytes <= 0)
+	{
+		return false;
+	}
+	
+	if (echo_ != NULL)
+	{
+		fwrite(&buffer_[0] + end_, 1, nr_bytes, echo_);
+		fflush(echo_);
+	}
+	end_ += nr_bytes;
+	return true;
+}
@@ -0,0 +1,120 @@
+#ifndef FLYING_TURTLEBOT_PLANNING_PLAN_PARSER_H
+#define FLYING_TURTLEBOT_PLANNING_PLAN_PARSER_H
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * Reads the output of FF while the planner is still running and returns the actions of the plan as soon
+ * as their line is complete. The output is read in large blocks and lines are found in place, so only
+ * the actions themselves are copied. All the output is echoed, as it is read.
+ *
+ * The plan starts at the line that contains "step    0:" and ends at the first line after that without a
+ * ':'. Every line of the plan has the form "<step>: <action name> <parameters>".
+ */
+class PlanParser
+{
+public:
+	/**
+	 * @param fd The file descriptor to read the output of the planner from.
+	 * @param echo Where to copy all the output to, NULL to not echo it.
+	 */
+	PlanParser(int fd, FILE* echo = stdout);
+	
+	/**
+	 * Parse output that is already available, e.g. a plan that was not made by the planner.
+	 * @param output The output, in the same format as that of FF.
+	 */
+	PlanParser(const std::string& output);
+	
+	/**
+	 * Stop waiting for the planner after @ref{seconds}, see @ref{hasTimedOut}.
+	 */
+	void setTimeLimit(float seconds);
+	
+	/**
+	 * @return True if the output ended because the time limit was reached, the planner might still be running.
+	 */
+	bool hasTimedOut() const { return has_timed_out_; }
+	
+	/**
+	 * @return The number of milliseconds until the time limit is reached, or -1 if there is no time limit.
+	 */
+	int getRemainingTime() const;
+	
+	/**
+	 * Read the output that is available now, without waiting for more. Used to wait for multiple planners at once.
+	 * @return False if the output has ended.
+	 */
+	bool readAvailable();
+	
+	/**
+	 * @return True if the first action of the plan has been read, it is not returned by @ref{getNextAction} yet.
+	 */
+	bool hasPlanStarted();
+	
+	/**
+	 * Start echoing the output, including the output that has been read already.
+	 */
+	void setEcho(FILE* echo);
+	
+	/**
+	 * @return The file descriptor the output is read from.
+	 */
+	int getFileDescriptor() const { return fd_; }
+	
+	/**
+	 * Wait for the next action of the plan (including POP and RAMINIFICATE).
+	 * @param full_action The action and its parameters will be stored here.
+	 * @param action_name The name of the action will be stored here.
+	 * @return True if an action was found, false if the plan has ended.
+	 */
+	bool getNextAction(std::string& full_action, std::string& action_name);
+	
+	/**
+	 * @return The name and the parameters of the last action returned by @ref{getNextAction}.
+	 */
+	const std::vector<std::string>& getParameters() const { return parameters_; }
+	
+	/**
+	 * Read (and echo) the output that follows the plan until the planner closes its output, such that
+	 * the planner does not block on a full pipe.
+	 */
+	void skipRemainingOutput();
+	
+private:
+	/**
+	 * Get the next complete line, it remains valid until the next call.
+	 * @return False if the output ended before another line was complete.
+	 */
+	bool getLine(const char*& line, size_t& length);
+	
+	/**
+	 * Read whatever is available into the buffer, blocks until at least one byte is available or the time
+	 * limit is reached.
+	 * @return False if the output has ended or the time limit was reached.
+	 */
+	bool read();
+	
+	/**
+	 * Read at most the free part of the buffer, which must not be empty.
+	 * @return False if the output has ended.
+	 */
+	bool readBlock();
+	
+	int fd_;
+	FILE* echo_;
+	std::vector<char> buffer_;
+	size_t begin_, end_;     // The part of buffer_ that has not been returned yet.
+	bool found_first_action_;
+	bool has_ended_;
+	bool has_time_limit_;
+	struct timespec deadline_;
+	bool has_timed_out_;
+	size_t plan_search_begin_;   // Where to continue searching for the first action, see hasPlanStarted.
+	std::vector<std::string> parameters_;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "PlannerPortfolio.h"
+
+#include <iostream>
+#include <errno.h>
+#include <poll.h>
+
+#include "PlannerProcess.h"
+#include "PlanParser.h"
+
+PlannerPortfolio::PlannerPortfolio(const std::vector<std::string>& command_lines)
+{
+	for (std::vector<std::string>::const_iterator ci = command_lines.begin(); ci != command_lines.end(); ++ci)
+	{
+		PlannerProcess* planner = new PlannerProcess(*ci);
+		planners_.push_back(planner);
+		outputs_.push_back(new PlanParser(planner->getOutput(), NULL));
+	}
+}
+
+PlannerPortfolio::~PlannerPortfolio()
+{
+	for (unsigned int i = 0; i < planners_.size(); ++i)
+	{
+		delete outputs_[i];
+		delete planners_[i];
+	}
+}
+
+void PlannerPortfolio::setTimeLimit(float seconds)
+{
+	for (std::vector<PlanParser*>::const_iterator ci = outputs_.begin(); ci != outputs_.end(); ++ci)
+	{
+		(*ci)->setTimeLimit(seconds);
+	}
+}
+
+int PlannerPortfolio::race()
+{
+	std::vector<bool> is_running(planners_.size(), true);
+	int winner = -1;
+	while (winner == -1)
+	{
+		std::vector<struct pollfd> poll_fds;
+		std::vector<unsigned int> indices;
+		for (unsigned int i = 0; i < outputs_.size(); ++i)
+		{
+			if (!is_running[i] || outputs_[i]->getFileDescriptor() < 0) continue;
+			
+			struct pollfd poll_fd;
+			poll_fd.fd = outputs_[i]->getFileDescriptor();
+			poll_fd.events = POLLIN;
+			poll_fd.revents = 0;
+			poll_fds.push_back(poll_fd);
+			indices.push_back(i);
+		}
+		
+		// Every planner ended without a plan.
+		if (poll_fds.empty())
+		{
+			break;
+		}
+		
+		// All the outputs have the same time limit.
+		int timeout = outputs_[indices[0]]->getRemainingTime();
+		if (timeout == 0)
+		{
+			break;
+		}
+		
+		int result = poll(&poll_fds[0], poll_fds.size(), timeout);
+		if (result < 0 && errno != EINTR)
+		{
+			std::cerr << "[PlannerPortfolio::race] Could not wait for the planners." << std::endl;
+			break;
+		}
+		
+		for (unsigned int i = 0; i < poll_fds.size() && winner == -1; ++i)
+		{
+			if (poll_fds[i].revents == 0) continue;
+			
+			PlanParser& output = *outputs_[indices[i]];
+			is_running[indices[i]] = output.readAvailable();
+			if (output.hasPlanStarted())
+			{
+				winner = indices[i];
+			}
+		}
+	}
+	
+	// Only the winner may continue, the others are killed without waiting for them.
+	for (unsigned int i = 0; i < planners_.size(); ++i)
+	{
+		if ((int)i != winner)
+		{
+			planners_[i]->kill();
+		}
+	}
+	if (winner != -1)
+	{
+		outputs_[winner]->setEcho(stdout);
+	}
+	return winner;
+}
+
+void PlannerPortfolio::stop()
+{
+	for (std::vector<PlannerProcess*>::const_iterator ci = planners_.begin(); ci != planners_.end(); ++ci)
+	{
+		(*ci)->stop();
+	}
+}
+
+void PlannerPortfolio::wait()
+{
+	for (std::vector<PlannerProcess*>::const_iterator ci = planners_.begin(); ci != planners_.end(); ++ci)
+	{
+		(*ci)->wait();
+	}
+}
+
+void PlannerPortfolio::getCommandLines(const std::string& configurations, std::vector<std::string>& command_lines)
+{
+	std::string::size_type begin = 0;
+	while (begin < configurations.size())
+	{
+		std::string::size_type end = configurations.find('\n', begin);
+		if (end == std::string::npos)
+		{
+			end = configurations.size();
+		}
+		if (end > begin)
+		{
+			command_lines.push_back(configurations.substr(begin, end - begin));
+		}
+		begin = end + 1;
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef FLYING_TURTLEBOT_PLANNING_PLANNER_PORTFOLIO_H
+#define FLYING_TURTLEBOT_PLANNING_PLANNER_PORTFOLIO_H
+
+#include <string>
+#include <vector>
+
+class PlannerProcess;
+class PlanParser;
+
+/**
+ * A number of planner configurations that race each other on the same problem. All the planners are started
+ * at once (the OS spreads them over the cores), the first one whose output reaches the plan wins and the
+ * others are stopped.
+ */
+class PlannerPortfolio
+{
+public:
+	/**
+	 * Start all the planners.
+	 * @param command_lines The command line of every planner configuration.
+	 */
+	PlannerPortfolio(const std::vector<std::string>& command_lines);
+	
+	/**
+	 * Stops all the planners that are still running.
+	 */
+	~PlannerPortfolio();
+	
+	/**
+	 * Stop waiting for the planners after @ref{seconds}, see @ref{PlanParser::setTimeLimit}.
+	 */
+	void setTimeLimit(float seconds);
+	
+	/**
+	 * Wait until one of the planners starts to output its plan, and kill all the other planners.
+	 * @return The index of the winning configuration, or -1 if all the planners ended without a plan or the time
+	 * limit was reached.
+	 */
+	int race();
+	
+	/**
+	 * @return The output of the planner of the configuration at @ref{index}.
+	 */
+	PlanParser& getOutput(unsigned int index) { return *outputs_[index]; }
+	
+	/**
+	 * Stop all the planners that are still running.
+	 */
+	void stop();
+	
+	/**
+	 * Wait until all the planners have exited.
+	 */
+	void wait();
+	
+	/**
+	 * Split a list of planner configurations, one per line. Empty lines are skipped.
+	 */
+	static void getCommandLines(const std::string& configurations, std::vector<std::string>& command_lines);
+	
+private:
+	std::vector<PlannerProcess*> planners_;
+	std::vector<PlanParser*> outputs_;
+};
+
+#endif
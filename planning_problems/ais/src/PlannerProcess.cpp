@@ -0,0 +1,128 @@
+#include "PlannerProcess.h"
+
+#include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+PlannerProcess::PlannerProcess(const std::string& command_line)
+	: pid_(-1), output_(-1), has_exited_(true), status_(-1)
+{
+	int pipe_fds[2];
+	if (pipe(pipe_fds) != 0)
+	{
+		std::cerr << "[PlannerProcess::PlannerProcess] Could not create a pipe for the planner." << std::endl;
+		return;
+	}
+	// Processes started by other threads must not keep the pipe open.
+	fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
+	
+	pid_ = fork();
+	if (pid_ == 0)
+	{
+		// Only async-signal-safe calls until the shell is started.
+		setpgid(0, 0);
+		dup2(pipe_fds[1], STDOUT_FILENO);
+		close(pipe_fds[0]);
+		close(pipe_fds[1]);
+		execl("/bin/sh", "sh", "-c", command_line.c_str(), (char*)NULL);
+		_exit(127);
+	}
+	close(pipe_fds[1]);
+	
+	if (pid_ < 0)
+	{
+		std::cerr << "[PlannerProcess::PlannerProcess] Could not start the planner." << std::endl;
+		close(pipe_fds[0]);
+		return;
+	}
+	
+	// Set the process group in the parent too, such that it exists before we might signal it.
+	setpgid(pid_, pid_);
+	output_ = pipe_fds[0];
+	has_exited_ = false;
+}
+
+PlannerProcess::~PlannerProcess()
+{
+	if (!has_exited_)
+	{
+		stop();
+		wait();
+	}
+	if (output_ != -1)
+	{
+		close(output_);
+	}
+}
+
+void PlannerProcess::stop(float grace_period)
+{
+	if (pid_ <= 0 || killpg(pid_, SIGTERM) != 0)
+	{
+		return;
+	}
+	
+	// The process group exists as long as any of its processes (including the shell) have not been reaped.
+	for (float waited = 0; waited < grace_period; waited += 0.01f)
+	{
+		hasExited();
+		if (killpg(pid_, 0) != 0)
+		{
+			return;
+		}
+		usleep(10000);
+	}
+	
+	std::cerr << "[PlannerProcess::stop] The planner did not stop after SIGTERM, send SIGKILL." << std::endl;
+	killpg(pid_, SIGKILL);
+}
+
+void PlannerProcess::kill()
+{
+	if (pid_ > 0)
+	{
+		killpg(pid_, SIGKILL);
+	}
+}
+
+int PlannerProcess::wait()
+{
+	while (!has_exited_)
+	{
+		int status;
+		pid_t result = waitpid(pid_, &status, 0);
+		if (result == pid_)
+		{
+			status_ = status;
+			has_exited_ = true;
+		}
+		else if (result < 0 && errno != EINTR)
+		{
+			has_exited_ = true;
+		}
+	}
+	return status_;
+}
+
+bool PlannerProcess::hasExited()
+{
+	if (!has_exited_)
+	{
+		int status;
+		pid_t result = waitpid(pid_, &status, WNOHANG);
+		if (result == pid_)
+		{
+			status_ = status;
+			has_exited_ = true;
+		}
+		else if (result < 0 && errno != EINTR)
+		{
+			has_exited_ = true;
+		}
+	}
+	return has_exited_;
+}
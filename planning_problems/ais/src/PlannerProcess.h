@@ -0,0 +1,60 @@
+#ifndef FLYING_TURTLEBOT_PLANNING_PLANNER_PROCESS_H
+#define FLYING_TURTLEBOT_PLANNING_PLANNER_PROCESS_H
+
+#include <string>
+#include <sys/types.h>
+
+/**
+ * A planner that runs as a child process in its own process group. The planner is started by /bin/sh, so
+ * the command line can contain redirections and background jobs; stopping the process group stops all of
+ * them. The standard output of the command can be read from @ref{getOutput}.
+ */
+class PlannerProcess
+{
+public:
+	/**
+	 * Start the planner.
+	 * @param command_line The command that runs the planner.
+	 */
+	PlannerProcess(const std::string& command_line);
+	
+	/**
+	 * Stops the planner if the shell that started it is still running.
+	 */
+	~PlannerProcess();
+	
+	/**
+	 * @return The file descriptor of the output of the planner, or -1 if it could not be started.
+	 */
+	int getOutput() const { return output_; }
+	
+	/**
+	 * Send SIGTERM to every process of the planner, and SIGKILL to those that have not exited after
+	 * @ref{grace_period} seconds.
+	 */
+	void stop(float grace_period = 1.0f);
+	
+	/**
+	 * Send SIGKILL to every process of the planner, without waiting for them to exit.
+	 */
+	void kill();
+	
+	/**
+	 * Wait until the shell that started the planner has exited.
+	 * @return The exit status of the shell, or -1 if it could not be started.
+	 */
+	int wait();
+	
+private:
+	/**
+	 * Check if the shell has exited, without waiting for it.
+	 */
+	bool hasExited();
+	
+	pid_t pid_;     // The process id of the shell, this is also the id of the process group.
+	int output_;
+	bool has_exited_;
+	int status_;
+};
+
+#endif
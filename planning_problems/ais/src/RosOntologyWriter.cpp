@@ -0,0 +1,60 @@
+#include "RosOntologyWriter.h"
+
+#include <iostream>
+
+#include <ontology_db/ontol_access.h>
+
+RosOntologyWriter::RosOntologyWriter(ros::NodeHandle& ros_node, OntolAccess& oa, const ros::ServiceClient* create_sproperty_client)
+	: ros_node_(&ros_node), oa_(&oa), can_add_values_(create_sproperty_client != NULL)
+{
+	create_instances_client_ = ros_node.serviceClient<ontology_db::CreateInstanceOfClass>("osl_ontology/create_instance_of_class", true);
+	if (create_sproperty_client != NULL)
+	{
+		create_sproperty_client_ = *create_sproperty_client;
+	}
+}
+
+bool RosOntologyWriter::doCreateInstance(const std::string& class_name, std::string& instance_name)
+{
+	// A persistent connection is closed if the service goes down, reconnect once it is back.
+	if (!create_instances_client_.isValid())
+	{
+		create_instances_client_ = ros_node_->serviceClient<ontology_db::CreateInstanceOfClass>("osl_ontology/create_instance_of_class", true);
+	}
+	
+	ontology_db::CreateInstanceOfClass create_instance;
+	create_instance.request.class_name = class_name;
+	if (!create_instances_client_.call(create_instance))
+	{
+		return false;
+	}
+	instance_name = create_instance.response.instance_name;
+	return true;
+}
+
+bool RosOntologyWriter::doSetFloatProperty(const std::string& instance_name, const std::string& property_name, float value)
+{
+	oa_->setFloatProperty(instance_name, property_name, value);
+	return true;
+}
+
+bool RosOntologyWriter::doSetStringProperty(const std::string& instance_name, const std::string& property_name, const std::string& value)
+{
+	oa_->setStringProperty(instance_name, property_name, value);
+	return true;
+}
+
+bool RosOntologyWriter::doAddStringPropertyValues(const std::string& instance_name, const std::string& property_name, const std::vector<std::string>& values)
+{
+	if (!can_add_values_)
+	{
+		std::cerr << "[RosOntologyWriter::doAddStringPropertyValues] No service to add values with." << std::endl;
+		return false;
+	}
+	
+	ontology_db::CreateStringPropertyValues add_values;
+	add_values.request.instance_name = instance_name;
+	add_values.request.property_name = property_name;
+	add_values.request.values = values;
+	return create_sproperty_client_.call(add_values);
+}
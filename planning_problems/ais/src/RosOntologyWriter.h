@@ -0,0 +1,39 @@
+#ifndef FLYING_TURTLEBOT_PLANNING_ROS_ONTOLOGY_WRITER_H
+#define FLYING_TURTLEBOT_PLANNING_ROS_ONTOLOGY_WRITER_H
+
+#include <ros/ros.h>
+
+#include "OntologyWriter.h"
+
+class OntolAccess;
+
+/**
+ * Writes to the ontology through its ROS services. The instances are created through a persistent connection,
+ * such that not every instance needs to set up a new connection.
+ */
+class RosOntologyWriter : public OntologyWriter
+{
+public:
+	/**
+	 * @param ros_node The node to connect to the services with.
+	 * @param oa Used to set the float and string properties.
+	 * @param create_sproperty_client The client of the service that adds string property values, NULL if values
+	 * are never added (only set).
+	 */
+	RosOntologyWriter(ros::NodeHandle& ros_node, OntolAccess& oa, const ros::ServiceClient* create_sproperty_client = NULL);
+	
+protected:
+	bool doCreateInstance(const std::string& class_name, std::string& instance_name);
+	bool doSetFloatProperty(const std::string& instance_name, const std::string& property_name, float value);
+	bool doSetStringProperty(const std::string& instance_name, const std::string& property_name, const std::string& value);
+	bool doAddStringPropertyValues(const std::string& instance_name, const std::string& property_name, const std::vector<std::string>& values);
+	
+private:
+	ros::NodeHandle* ros_node_;
+	OntolAccess* oa_;
+	ros::ServiceClient create_instances_client_;
+	ros::ServiceClient create_sproperty_client_;
+	bool can_add_values_;
+};
+
+#endif
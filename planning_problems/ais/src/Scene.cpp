@@ -7,14 +7,27 @@
 #include <turtlebot_planner/Ontology/Vector2D.h>
 #include <turtlebot_planner/Ontology/Shape.h>
 #include <turtlebot_planner/Ontology/Face.h>
+#include <turtlebot_planner/Ontology/FaceGrid.h>
+#include <turtlebot_planner/Ontology/ShapeQueryCache.h>
+#include <turtlebot_planner/Ontology/VisibilitySweep.h>
+#include <turtlebot_planner/Ontology/WaypointConnectivity.h>
+#include <turtlebot_planner/Ontology/DistanceField.h>
 #include "../Waypoint.h"
+#include "../WaypointSearch.h"
 #include "../OccupancyGridFunction.h"
-#include <queue>
+#include <algorithm>
+#include <set>
 
 std::map<std::string, std::vector<Shape*>* > Scene::object_in_scene_cache_;
+ShapeQueryCache Scene::shape_query_cache_;
+float Scene::distance_field_resolution_ = 0.1f;
+pthread_mutex_t Scene::occupancy_grid_mutex_ = PTHREAD_MUTEX_INITIALIZER;
+
+// The distance field stores distances up to the length of the rays of isAccessible plus the clearance of canConnect.
+static const float DISTANCE_FIELD_MAX_DISTANCE = 2.5f;
 
 Scene::Scene(OntolAccess& oa, const std::string& scene_name, OccupancyGridFunction& occupancy_grid_function)
-	: oa_(&oa), ontology_name_(scene_name), occupancy_grid_function_(&occupancy_grid_function)
+	: oa_(&oa), ontology_name_(scene_name), occupancy_grid_function_(&occupancy_grid_function), face_grid_(NULL), waypoint_search_(new WaypointSearch()), connectivity_(new WaypointConnectivity()), distance_field_(NULL)
 {
 	std::cout << "[Scene::Scene] Create a new scene named '" << scene_name << "'" << std::endl;
 	std::vector<std::string> scenes = oa.getStringProperty(scene_name, "oslshape:'hasObject'");
@@ -34,16 +47,34 @@ Scene::Scene(OntolAccess& oa, const std::string& scene_name, OccupancyGridFuncti
 	{
 		loadShapes(*ci);
 	}
+	
+	face_grid_ = new FaceGrid(shapes_);
+	distance_field_ = new DistanceField(shapes_, distance_field_resolution_, DISTANCE_FIELD_MAX_DISTANCE);
+	addShapesToCache();
 }
 
 Scene::Scene(const std::vector<Shape*>& shapes, OccupancyGridFunction& occupancy_grid_function)
-	: shapes_(shapes), occupancy_grid_function_(&occupancy_grid_function)
+	: shapes_(shapes), occupancy_grid_function_(&occupancy_grid_function), waypoint_search_(new WaypointSearch()), connectivity_(new WaypointConnectivity()), distance_field_(NULL)
 {
-	
+	face_grid_ = new FaceGrid(shapes_);
+	distance_field_ = new DistanceField(shapes_, distance_field_resolution_, DISTANCE_FIELD_MAX_DISTANCE);
+	addShapesToCache();
+}
+
+Scene::Scene(const std::string& scene_name, const std::vector<Shape*>& shapes, float probability, OccupancyGridFunction* occupancy_grid_function)
+	: oa_(NULL), ontology_name_(scene_name), occupancy_grid_function_(occupancy_grid_function), probability_(probability), shapes_(shapes), waypoint_search_(new WaypointSearch()), connectivity_(new WaypointConnectivity()), distance_field_(NULL)
+{
+	face_grid_ = new FaceGrid(shapes_);
+	distance_field_ = new DistanceField(shapes_, distance_field_resolution_, DISTANCE_FIELD_MAX_DISTANCE);
+	addShapesToCache();
 }
 
 Scene::~Scene()
 {
+	delete face_grid_;
+	delete waypoint_search_;
+	delete connectivity_;
+	delete distance_field_;
 	for (std::vector<Shape*>::const_iterator ci = shapes_.begin(); ci != shapes_.end(); ++ci)
 	{
 		delete *ci;
@@ -63,6 +94,51 @@ void Scene::clearCache()
 	}
 	*/
 	object_in_scene_cache_.clear();
+	shape_query_cache_.clear();
+}
+
+void Scene::startReload()
+{
+	object_in_scene_cache_.clear();
+	shape_query_cache_.markShapesUnused();
+}
+
+void Scene::finishReload()
+{
+	unsigned int nr_removed_shapes = shape_query_cache_.removeUnusedShapes();
+	std::cout << "[Scene::finishReload] Forgot the queries of " << nr_removed_shapes << " shapes, " << shape_query_cache_.getNumberOfCachedResults() << " results are kept." << std::endl;
+}
+
+void Scene::addShapesToCache()
+{
+	// The face grid numbers the faces in the order of the shapes.
+	for (std::vector<Shape*>::const_iterator ci = shapes_.begin(); ci != shapes_.end(); ++ci)
+	{
+		unsigned int shape_id = shape_query_cache_.addShape(**ci);
+		ShapeQueryCache::addToShapeSet(shape_set_, shape_id);
+		face_shape_ids_.insert(face_shape_ids_.end(), (*ci)->getFaces().size(), shape_id);
+	}
+}
+
+bool Scene::isNearSegment(const Vector2D& from, const Vector2D& to, float distance) const
+{
+	ShapeQueryCache::RESULT result = shape_query_cache_.getResult(shape_set_, from, to, distance);
+	if (result != ShapeQueryCache::UNKNOWN)
+	{
+		return result == ShapeQueryCache::NEAR;
+	}
+	
+	// Only the shapes that have a face near the segment can be near it.
+	std::vector<unsigned int> face_ids;
+	face_grid_->getCandidates(from, to, distance, face_ids);
+	std::vector<unsigned int> candidate_ids;
+	for (std::vector<unsigned int>::const_iterator ci = face_ids.begin(); ci != face_ids.end(); ++ci)
+	{
+		candidate_ids.push_back(face_shape_ids_[*ci]);
+	}
+	std::sort(candidate_ids.begin(), candidate_ids.end());
+	candidate_ids.erase(std::unique(candidate_ids.begin(), candidate_ids.end()), candidate_ids.end());
+	return shape_query_cache_.isNearSegment(shape_set_, candidate_ids, from, to, distance);
 }
 
 bool Scene::isAccessible(float x, float y)
@@ -73,6 +149,16 @@ bool Scene::isAccessible(float x, float y)
 	Vector2D east(x - 2, y);
 	Vector2D south(x, y - 2);
 	
+	// If there are no faces near any of the rays, only the occupancy grid can block them.
+	float min_distance, max_distance;
+	if (distance_field_->getBounds(centre, min_distance, max_distance) && min_distance >= 2.25f)
+	{
+		return isFreeOnMap(centre, north, 0.25f) ||
+		       isFreeOnMap(centre, west, 0.25f) ||
+		       isFreeOnMap(centre, east, 0.25f) ||
+		       isFreeOnMap(centre, south, 0.25f);
+	}
+	
 	if (canConnect(centre, north) ||
 	    canConnect(centre, west) ||
 	    canConnect(centre, east) ||
@@ -83,7 +169,11 @@ bool Scene::isAccessible(float x, float y)
 	return false;
 }
 
-bool Scene::canSee(const Face& face, const Vector2D& location) const
+/**
+ * Check if the angle between the normal of @ref{face} and the direction from its centre to @ref{location} is small
+ * enough to observe the face.
+ */
+static bool isWithinViewingAngle(const Face& face, const Vector2D& location)
 {
 	Vector2D face_p1(face.getP1().x_, face.getP1().y_);
 	Vector2D face_p2(face.getP2().x_, face.getP2().y_);
@@ -96,133 +186,128 @@ bool Scene::canSee(const Face& face, const Vector2D& location) const
 	Vector2D to_view = location - face_centre;
 	to_view.normalise();
 	
-	if (Vector2D::dot(to_view, projected_normal) < 0.5f)
+	return Vector2D::dot(to_view, projected_normal) >= 0.5f;
+}
+
+bool Scene::canSee(const Face& face, const Vector2D& location) const
+{
+	if (!isWithinViewingAngle(face, location))
 	{
 		return false;
 	}
 	
+	Vector2D face_p1(face.getP1().x_, face.getP1().y_);
+	Vector2D face_p2(face.getP2().x_, face.getP2().y_);
+	
+	// Only the faces near the lines of sight to both end points of the face can block it.
+	std::vector<unsigned int> face_ids;
+	face_grid_->getCandidates(location, face_p1, 0.01f, face_ids);
+	std::vector<unsigned int> face_p2_ids;
+	face_grid_->getCandidates(location, face_p2, 0.01f, face_p2_ids);
+	face_ids.insert(face_ids.end(), face_p2_ids.begin(), face_p2_ids.end());
+	std::sort(face_ids.begin(), face_ids.end());
+	face_ids.erase(std::unique(face_ids.begin(), face_ids.end()), face_ids.end());
+	
 	//std::cout << "Can we see: " << face.getP1() << " - " << face.getP2() << " from " << location << "?" << std::endl;
-	for (std::vector<Shape*>::const_iterator ci = shapes_.begin(); ci != shapes_.end(); ++ci)
+	for (std::vector<unsigned int>::const_iterator ci = face_ids.begin(); ci != face_ids.end(); ++ci)
 	{
-		const Shape* shape = *ci;
-		for (std::vector<const Face*>::const_iterator ci = shape->getFaces().begin(); ci != shape->getFaces().end(); ++ci)
+		const Face* other_face = &face_grid_->getFace(*ci);
+		if (other_face == &face)
 		{
-			const Face* other_face = *ci;
-			if (other_face == &face)
-			{
-				continue;
-			}
-			
-			Vector2D other_face_p1(other_face->getP1().x_, other_face->getP1().y_);
-			Vector2D other_face_p2(other_face->getP2().x_, other_face->getP2().y_);
-			
-			Vector2D intersection;
-			if (Vector2D::getIntersectionSegments(location, face_p1, other_face_p1, other_face_p2, intersection) &&
-			   intersection.getDistance(face_p1) > 0.01f)
-			{
-				//std::cout << "No! The face: " << other_face->getP1() << " - " << other_face->getP2() << " blocks it!" << std::endl;
-				return false;
-			}
-			
-			if (Vector2D::getIntersectionSegments(location, face_p2, other_face_p1, other_face_p2, intersection) &&
-			   intersection.getDistance(face_p2) > 0.01f)
-			{
-				//std::cout << "No! The face: " << other_face->getP1() << " - " << other_face->getP2() << " blocks it!" << std::endl;
-				return false;
-			}
-			
-			/*
-			if (getDistance(Vector3D(location.x_, location.y_, 0), face.getP1(), other_face->getP1(), other_face->getP2()) < 0.15f ||
-			    getDistance(Vector3D(location.x_, location.y_, 0), face.getP2(), other_face->getP1(), other_face->getP2()) < 0.15f)
-			{
-				std::cout << "No! The face: " << other_face->getP1() << " - " << other_face->getP2() << " blocks it!" << std::endl;
-				return false;
-			}
-			*/
+			continue;
+		}
+		
+		Vector2D other_face_p1(other_face->getP1().x_, other_face->getP1().y_);
+		Vector2D other_face_p2(other_face->getP2().x_, other_face->getP2().y_);
+		
+		Vector2D intersection;
+		if (Vector2D::getIntersectionSegments(location, face_p1, other_face_p1, other_face_p2, intersection) &&
+		   intersection.getDistance(face_p1) > 0.01f)
+		{
+			//std::cout << "No! The face: " << other_face->getP1() << " - " << other_face->getP2() << " blocks it!" << std::endl;
+			return false;
+		}
+		
+		if (Vector2D::getIntersectionSegments(location, face_p2, other_face_p1, other_face_p2, intersection) &&
+		   intersection.getDistance(face_p2) > 0.01f)
+		{
+			//std::cout << "No! The face: " << other_face->getP1() << " - " << other_face->getP2() << " blocks it!" << std::endl;
+			return false;
 		}
 	}
 	//std::cout << "Yes we can!" << std::endl;
 	return true;
 }
 	
-bool Scene::canConnect(const Vector2D& from, const Vector2D& to) const
+void Scene::canSee(const std::vector<const Face*>& faces, const Vector2D& location, std::vector<bool>& is_visible) const
 {
-	geometry_msgs::Point from_point;
-	from_point.x = from.x_;
-	from_point.y = from.y_;
-	from_point.z = 0;
-	
-	geometry_msgs::Point to_point;
-	to_point.x = to.x_;
-	to_point.y = to.y_;
-	to_point.z = 0;
-	Vector3D face_p1(from.x_, from.y_, 0.0f);
-	Vector3D face_p2(to.x_, to.y_, 0.0f);
-	if (!occupancy_grid_function_->canConnect(from_point, to_point, 0.25f))
+	std::vector<const Face*> scene_faces;
+	for (std::vector<Shape*>::const_iterator ci = shapes_.begin(); ci != shapes_.end(); ++ci)
 	{
-		return false;
+		scene_faces.insert(scene_faces.end(), (*ci)->getFaces().begin(), (*ci)->getFaces().end());
 	}
 	
-	Vector2D intersection;
-	for (std::vector<Shape*>::const_iterator ci = shapes_.begin(); ci != shapes_.end(); ++ci)
+	// A face is visible if the lines of sight to both of its end points are clear, apart from the face itself.
+	VisibilitySweep sweep(location, scene_faces);
+	std::vector<int> query_ids(faces.size(), -1);
+	for (unsigned int i = 0; i < faces.size(); ++i)
 	{
-		const Shape* shape = *ci;
-		for (std::vector<const Face*>::const_iterator ci = shape->getFaces().begin(); ci != shape->getFaces().end(); ++ci)
+		const Face* face = faces[i];
+		if (isWithinViewingAngle(*face, location))
 		{
-			const Face* other_face = *ci;
-			Vector3D other_face_p1(other_face->getP1().x_, other_face->getP1().y_, 0.0f);
-			Vector3D other_face_p2(other_face->getP2().x_, other_face->getP2().y_, 0.0f);
-			
-			if (Vector3D::getDistance(face_p1, face_p2, other_face_p1, other_face_p2) < 0.25f)
-			{
-				return false;
-			}
-			/*
-			if (Vector2D::getIntersectionSegments(from, to, other_face_p1, other_face_p2, intersection))
-			{
-				return false;
-			}
-			*/
+			query_ids[i] = sweep.addQuery(Vector2D(face->getP1().x_, face->getP1().y_), face);
+			sweep.addQuery(Vector2D(face->getP2().x_, face->getP2().y_), face);
 		}
 	}
-	return true;
+	sweep.sweep();
+	
+	is_visible.resize(faces.size());
+	for (unsigned int i = 0; i < faces.size(); ++i)
+	{
+		is_visible[i] = query_ids[i] != -1 && sweep.isVisible(query_ids[i]) && sweep.isVisible(query_ids[i] + 1);
+	}
+}
+
+bool Scene::canConnect(const Vector2D& from, const Vector2D& to) const
+{
+	if (!isFreeOnMap(from, to, 0.25f))
+	{
+		return false;
+	}
+	
+	return !isNearSegment(from, to, 0.25f);
 }
 
 bool Scene::canSee(const Vector2D& location, const Vector2D& point) const
+{
+	if (!isFreeOnMap(location, point, 0.01f))
+	{
+		return false;
+	}
+	
+	return !isNearSegment(location, point, 0.01f);
+}
+
+bool Scene::isFreeOnMap(const Vector2D& from, const Vector2D& to, float distance) const
 {
 	geometry_msgs::Point from_point;
-	from_point.x = location.x_;
-	from_point.y = location.y_;
+	from_point.x = from.x_;
+	from_point.y = from.y_;
 	from_point.z = 0;
 	
 	geometry_msgs::Point to_point;
-	to_point.x = point.x_;
-	to_point.y = point.y_;
+	to_point.x = to.x_;
+	to_point.y = to.y_;
 	to_point.z = 0;
-	Vector3D face_p1(location.x_, location.y_, 0.0f);
-	Vector3D face_p2(point.x_, point.y_, 0.0f);
-	if (!occupancy_grid_function_->canConnect(from_point, to_point, 0.01f))
+	if (occupancy_grid_function_ == NULL)
 	{
-		return false;
+		return true;
 	}
 	
-	Vector2D intersection;
-	for (std::vector<Shape*>::const_iterator ci = shapes_.begin(); ci != shapes_.end(); ++ci)
-	{
-		const Shape* shape = *ci;
-		for (std::vector<const Face*>::const_iterator ci = shape->getFaces().begin(); ci != shape->getFaces().end(); ++ci)
-		{
-			const Face* other_face = *ci;
-			Vector3D other_face_p1(other_face->getP1().x_, other_face->getP1().y_, 0.0f);
-			Vector3D other_face_p2(other_face->getP2().x_, other_face->getP2().y_, 0.0f);
-			
-			if (Vector3D::getDistance(face_p1, face_p2, other_face_p1, other_face_p2) < 0.01f)
-			{
-				return false;
-			}
-		}
-	}
-	return true;
+	pthread_mutex_lock(&occupancy_grid_mutex_);
+	bool can_connect = occupancy_grid_function_->canConnect(from_point, to_point, distance);
+	pthread_mutex_unlock(&occupancy_grid_mutex_);
+	return can_connect;
 }
 
 void Scene::loadShapes(const std::string& object_name)
@@ -350,152 +435,52 @@ bool Scene::isFullyConnected(Waypoint& enter_waypoint, Waypoint& exit_waypoint,
 
 bool Scene::isFullyConnected(Waypoint& enter_waypoint, Waypoint& exit_waypoint, const std::vector<Waypoint*>& waypoints, const std::vector<Waypoint*>& view_cones, const std::vector<Vector2D>& view_points, const std::vector<const Face*>& faces, std::vector<Waypoint*>& unconnected_inspection_points)
 {
-	std::set<const Face*> observed_faces;
-	std::set<Vector2D> observed_view_points;
-	
-	Vector2D enter_loc(enter_waypoint.x_, enter_waypoint.y_);
-		
-	for (std::vector<const Face*>::const_iterator ci = faces.begin(); ci != faces.end(); ++ci)
-	{
-		if (canSee(**ci, enter_loc))
-		{
-			observed_faces.insert(*ci);
-		}
-	}
-	
-	
-	for (std::vector<Vector2D>::const_iterator ci = view_points.begin(); ci != view_points.end(); ++ci)
-	{
-		if (canConnect(*ci, enter_loc))
-		{
-			observed_view_points.insert(*ci);
-		}
-	}
+	connectivity_->setTargets(view_points, faces);
 	
 	std::vector<Waypoint*> all_waypoints(waypoints);
 	all_waypoints.insert(all_waypoints.end(), view_cones.begin(), view_cones.end());
 	all_waypoints.push_back(&enter_waypoint);
 	all_waypoints.push_back(&exit_waypoint);
 	
-	// Establish the edges of the waypoints.
-	for (int i = 0; i < all_waypoints.size(); ++i)
-	{
-		Waypoint* wp = all_waypoints[i];
-		wp->edges_.clear();
-	}
-	
-	for (int i = 0; i < all_waypoints.size(); ++i)
+	// Only the waypoints that were not part of a previous call need to be connected.
+	for (std::vector<Waypoint*>::const_iterator ci = all_waypoints.begin(); ci != all_waypoints.end(); ++ci)
 	{
-		Waypoint* wp = all_waypoints[i];
-		//wp->edges_.clear();
-		for (int j = i + 1; j < all_waypoints.size(); ++j)
-		{
-			Waypoint* other_wp = all_waypoints[j];
-			
-			if (canConnect(Vector2D(wp->x_, wp->y_), Vector2D(other_wp->x_, other_wp->y_)))
-			{
-				wp->addEdge(*other_wp);
-				other_wp->addEdge(*wp);
-			}
-		}
-	}
-	
-	std::vector<const Waypoint*> open_queue;
-	open_queue.push_back(&enter_waypoint);
-	
-	std::set<const Waypoint*> reachable_waypoints;
-	//reachable_waypoints.insert(&enter_waypoint);
-	
-	while (open_queue.size() > 0)
-	{
-		const Waypoint* current_waypoint = *open_queue.begin();
-		open_queue.erase(open_queue.begin());
-		
-		if (reachable_waypoints.count(current_waypoint) == 1)
+		const Waypoint* waypoint = *ci;
+		if (connectivity_->getId(*waypoint) != -1)
 		{
 			continue;
 		}
-		reachable_waypoints.insert(current_waypoint);
-		
-		for (std::vector<const Face*>::const_iterator ci = faces.begin(); ci != faces.end(); ++ci)
-		{
-			if (canSee(**ci, Vector2D(current_waypoint->x_, current_waypoint->y_)))
-			{
-				observed_faces.insert(*ci);
-			}
-		}
-		
+		Vector2D location(waypoint->x_, waypoint->y_);
 		
+		std::vector<bool> observations;
+		canSee(faces, location, observations);
 		for (std::vector<Vector2D>::const_iterator ci = view_points.begin(); ci != view_points.end(); ++ci)
 		{
-			if (canSee(*ci, Vector2D(current_waypoint->x_, current_waypoint->y_)))
-			{
-				observed_view_points.insert(*ci);
-			}
+			// The view points near the entrance can be observed without a clear line of sight.
+			observations.push_back(canSee(*ci, location) || (waypoint == &enter_waypoint && canConnect(*ci, location)));
 		}
 		
-		for (std::vector<std::pair<float, Waypoint*> >::const_iterator ci = current_waypoint->edges_.begin(); ci != current_waypoint->edges_.end(); ++ci)
-		{
-			open_queue.push_back((*ci).second);
-		}
-	}
-	
-	/*
-	bool finished = false;
-	while (!finished)
-	{
-		finished = true;
-		for (std::vector<Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
+		// Waypoints that are already in the same component do not need to be tested.
+		unsigned int waypoint_id = connectivity_->addWaypoint(*waypoint, observations);
+		for (unsigned int other_waypoint_id = 0; other_waypoint_id < waypoint_id; ++other_waypoint_id)
 		{
-			if (reachable_waypoints.count(*ci) == 1)
+			if (connectivity_->isConnected(waypoint_id, other_waypoint_id))
 			{
 				continue;
 			}
-			const Waypoint* wp1 = *ci;
-			bool can_connect = false;
 			
-			//std::cout << "Try connecting: " << *wp1 << std::endl;
-				
-			for (std::set<const Waypoint*>::const_iterator ci = reachable_waypoints.begin(); ci != reachable_waypoints.end(); ++ci)
+			const Waypoint& other_waypoint = connectivity_->getWaypoint(other_waypoint_id);
+			if (canConnect(location, Vector2D(other_waypoint.x_, other_waypoint.y_)))
 			{
-				const Waypoint* wp2 = *ci;
-				if (canConnect(Vector2D(wp1->x_, wp1->y_), Vector2D(wp2->x_, wp2->y_)))
-				{
-					//std::cout << *wp1 << " can connect with:" << *wp2 << std::endl;
-					can_connect = true;
-					break;
-				}
-			}
-			
-			if (can_connect)
-			{
-				finished = false;
-				reachable_waypoints.insert(wp1);
-				
-				for (std::vector<const Face*>::const_iterator ci = faces.begin(); ci != faces.end(); ++ci)
-				{
-					if (canSee(**ci, Vector2D(wp1->x_, wp1->y_)))
-					{
-						observed_faces.insert(*ci);
-					}
-				}
-				
-				
-				for (std::vector<Vector2D>::const_iterator ci = view_points.begin(); ci != view_points.end(); ++ci)
-				{
-					//if (canConnect(*ci, Vector2D(wp1->x_, wp1->y_)))
-					if (canSee(*ci, Vector2D(wp1->x_, wp1->y_)))
-					{
-						observed_view_points.insert(*ci);
-					}
-				}
+				connectivity_->connect(waypoint_id, other_waypoint_id);
 			}
 		}
 	}
-	*/
-	if (observed_faces.size() != faces.size() || observed_view_points.size() != view_points.size())
+	
+	unsigned int enter_id = connectivity_->getId(enter_waypoint);
+	if (!connectivity_->observesAllTargets(enter_id))
 	{
-		std::cout << observed_faces.size() << "/" << faces.size() << "::" << observed_view_points.size() << "/" << view_points.size() << std::endl;
+		std::cout << connectivity_->getNumberOfObservedTargets(enter_id) << "/" << (faces.size() + view_points.size()) << std::endl;
 		return false;
 	}
 
@@ -503,95 +488,81 @@ bool Scene::isFullyConnected(Waypoint& enter_waypoint, Waypoint& exit_waypoint,
 	bool view_cones_accessable = true;
 	for (std::vector<Waypoint*>::const_iterator ci = view_cones.begin(); ci != view_cones.end(); ++ci)
 	{
-		if (reachable_waypoints.count(*ci) == 0)
+		if (!connectivity_->isConnected(enter_id, connectivity_->getId(**ci)))
 		{
 			std::cout << (*ci)->ontology_id_ << std::endl;
 			unconnected_inspection_points.push_back(*ci);
 			view_cones_accessable = false;
 		}
 	}
-	/*
-	if (reachable_waypoints.count(&exit_waypoint) == 0)
-	{
-		std::cout << "Exit not linked!" << std::endl;
-		return false;
-	}
-	*/
 	return view_cones_accessable;
 }
 
-const Face* Scene::getFace(const std::string& face_name) const
+void Scene::connectWaypoints(const std::vector<Waypoint*>& waypoints) const
 {
-	for (std::vector<Shape*>::const_iterator ci = shapes_.begin(); ci != shapes_.end(); ++ci)
+	for (std::vector<Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
 	{
-		Shape* shape = *ci;
-		const Face* face = shape->getFace(face_name);
-		if (face != NULL)
-		{
-			return face;
-		}
+		(*ci)->edges_.clear();
 	}
 	
-	return NULL;
-}
-
-std::vector<Waypoint*> Scene::findPath(Waypoint& from, Waypoint& to, const std::vector<Waypoint*>& all_waypoints) const
-{
-	std::vector<WaypointNode*> all_nodes;
-	
-	// Find a path!
-	std::priority_queue<WaypointNode*, std::vector<WaypointNode*>, WaypointNode> queue;
-	
-	std::set<Waypoint*> closed_set;
-	
-	std::vector<WaypointNode*> path;
-	queue.push(new WaypointNode(from, NULL, to, 0, path));
-	
-	while (queue.size() > 0)
+	// Every pair is tested once, so we can skip the duplicate check of Waypoint::addEdge.
+	std::set<Waypoint*> connected_waypoints;
+	for (unsigned int i = 0; i < waypoints.size(); ++i)
 	{
-		WaypointNode* current_node = queue.top();
-		queue.pop();
-		
-		if (closed_set.count(current_node->waypoint_) == 1)
+		Waypoint* waypoint = waypoints[i];
+		if (!connected_waypoints.insert(waypoint).second)
 		{
 			continue;
 		}
-		closed_set.insert(current_node->waypoint_);
 		
-		// Check if this is the goal.
-		if (current_node->waypoint_ == &to)
+		for (unsigned int j = i + 1; j < waypoints.size(); ++j)
 		{
-			const std::vector<WaypointNode*>& path = current_node->path_;
-			std::vector<Waypoint*> final_path;
-			for (std::vector<WaypointNode*>::const_iterator ci = path.begin(); ci != path.end(); ++ci)
+			Waypoint* other_waypoint = waypoints[j];
+			if (connected_waypoints.count(other_waypoint) == 1)
 			{
-				WaypointNode* node = *ci;
-				final_path.insert(final_path.end(), node->waypoint_);
+				continue;
 			}
 			
-			for (std::vector<WaypointNode*>::const_iterator ci = all_nodes.begin(); ci != all_nodes.end(); ++ci)
+			if (canConnect(Vector2D(waypoint->x_, waypoint->y_), Vector2D(other_waypoint->x_, other_waypoint->y_)))
 			{
-				delete *ci;
+				float distance = waypoint->getDistanceTo(*other_waypoint);
+				waypoint->edges_.push_back(std::make_pair(distance, other_waypoint));
+				other_waypoint->edges_.push_back(std::make_pair(distance, waypoint));
 			}
-			return final_path;
-		}
-		
-		std::vector<WaypointNode*> children;
-		current_node->getChildren(children);
-		for (std::vector<WaypointNode*>::const_iterator ci = children.begin(); ci != children.end(); ++ci)
-		{
-			queue.push(*ci);
-			all_nodes.push_back(*ci);
 		}
 	}
-	
-	for (std::vector<WaypointNode*>::const_iterator ci = all_nodes.begin(); ci != all_nodes.end(); ++ci)
+}
+
+const Face* Scene::getFace(const std::string& face_name) const
+{
+	for (std::vector<Shape*>::const_iterator ci = shapes_.begin(); ci != shapes_.end(); ++ci)
 	{
-		delete *ci;
+		Shape* shape = *ci;
+		const Face* face = shape->getFace(face_name);
+		if (face != NULL)
+		{
+			return face;
+		}
 	}
 	
-	std::vector<Waypoint*> final_path;
-	return final_path;
+	return NULL;
+}
+
+std::vector<Waypoint*> Scene::findPath(Waypoint& from, Waypoint& to) const
+{
+	std::vector<Waypoint*> path;
+	waypoint_search_->findPath(from, to, path);
+	return path;
+}
+
+void Scene::findPaths(Waypoint& from, const std::vector<Waypoint*>& targets, std::vector<std::vector<Waypoint*> >& paths) const
+{
+	waypoint_search_->findPaths(from, targets, paths);
+}
+
+unsigned int Scene::addPathWaypoints(Waypoint& from, const std::vector<Waypoint*>& targets, std::set<Waypoint*>& waypoints) const
+{
+	return waypoint_search_->addPathWaypoints(from, targets, waypoints);
 }
 
 bool Scene::isBlocked(const Vector2D& point, float min_distance) const
@@ -599,25 +570,24 @@ bool Scene::isBlocked(const Vector2D& point, float min_distance) const
 	geometry_msgs::Point p;
 	p.x = point.x_;
 	p.y = point.y_;
-	if (occupancy_grid_function_->isBlocked(p, min_distance))
+	if (occupancy_grid_function_ != NULL)
 	{
-		return true;
+		pthread_mutex_lock(&occupancy_grid_mutex_);
+		bool is_blocked = occupancy_grid_function_->isBlocked(p, min_distance);
+		pthread_mutex_unlock(&occupancy_grid_mutex_);
+		if (is_blocked)
+		{
+			return true;
+		}
 	}
 	
-	Vector3D point_3d(point.x_, point.y_, 0.0f);
-	for (std::vector<Shape*>::const_iterator ci = shapes_.begin(); ci != shapes_.end(); ++ci)
+	// Only points near the faces need the exact distance.
+	float lower_bound, upper_bound;
+	if (distance_field_->getBounds(point, lower_bound, upper_bound) && lower_bound >= min_distance)
 	{
-		const Shape* shape = *ci;
-		for (std::vector<const Face*>::const_iterator ci = shape->getFaces().begin(); ci != shape->getFaces().end(); ++ci)
-		{
-			const Face* face = *ci;
-			if (Vector3D::getDistance(point_3d, face->getP1(), face->getP2()) < min_distance)
-			{
-				return true;
-			}
-		}
+		return false;
 	}
-	return false;
+	return face_grid_->isNearPoint(Vector3D(point.x_, point.y_, 0.0f), min_distance);
 }
 
 std::ostream& operator<<(std::ostream& os, const Scene& scene)
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <pthread.h>
 
 #include "Vector3D.h"
 
@@ -14,6 +16,11 @@ class OntolAccess;
 class Shape;
 class Waypoint;
 class OctomapBuilder;
+class FaceGrid;
+class ShapeQueryCache;
+class WaypointSearch;
+class WaypointConnectivity;
+class DistanceField;
 
 /**
  * The ontology stores scenes which are based on the known shapes an observations so far.
@@ -31,12 +38,38 @@ public:
 	 */
 	Scene(const std::vector<Shape*>& shapes, OccupancyGridFunction& occupancy_grid_function);
 	
+	/**
+	 * Create a scene that was not loaded from the ontology (see @ref{SceneFile}).
+	 * @param occupancy_grid_function The map to check for obstacles, NULL if only the shapes are obstacles.
+	 */
+	Scene(const std::string& scene_name, const std::vector<Shape*>& shapes, float probability, OccupancyGridFunction* occupancy_grid_function);
+	
 	~Scene();
 	
 	static void clearCache();
 	
+	/**
+	 * Prepare the caches for loading a new set of scenes. Unlike @ref{clearCache}, the line segment queries of the
+	 * shapes that are part of the new scenes as well are remembered, so only the shapes that changed are tested again.
+	 * Call @ref{finishReload} once all the new scenes have been created.
+	 */
+	static void startReload();
+	
+	/**
+	 * Forget the line segment queries of the shapes that are not part of any of the scenes created since @ref{startReload}.
+	 */
+	static void finishReload();
+	
+	/**
+	 * Set the width and height of the cells of the distance field that speeds up @ref{isBlocked} and
+	 * @ref{isAccessible}. Only affects scenes that are created afterwards.
+	 */
+	static void setDistanceFieldResolution(float resolution) { distance_field_resolution_ = resolution; }
+	
 	const std::vector<Shape*>& getShapes() const { return shapes_; }
 	
+	const std::string& getName() const { return ontology_name_; }
+	
 	float getProbability() const { return probability_; }
 	
 	/**
@@ -53,6 +86,16 @@ public:
 	 */
 	bool canSee(const Face& face, const Vector2D& location) const;
 	
+	/**
+	 * Check which of the @ref{faces} are visible from @ref{location}. The result is the same as calling @ref{canSee}
+	 * for every face, but all the lines of sight are tested in a single sweep around @ref{location} (see
+	 * @ref{VisibilitySweep}), which is much cheaper when there are many faces.
+	 * @param faces The faces we try to determine the visibility of, these need not be part of this scene.
+	 * @param location The location we try to view the faces from.
+	 * @param is_visible For every face whether it is visible from @ref{location} will be stored here.
+	 */
+	void canSee(const std::vector<const Face*>& faces, const Vector2D& location, std::vector<bool>& is_visible) const;
+	
 	/**
 	 * Check if these two waypoints can be connected.
 	 * @param from The first part of the line segment.
@@ -62,9 +105,26 @@ public:
 	bool canConnect(const Vector2D& from, const Vector2D& to) const;
 	
 	/**
-	 * Find the shortest path @ref{from} to @ref{to}.
+	 * Find the shortest path @ref{from} to @ref{to} over the edges of the waypoints (see @ref{connectWaypoints}).
+	 * All the searches of a scene reuse the buffers of @ref{waypoint_search_}, so unlike the other const functions
+	 * this one must not be called from multiple threads at the same time; the same holds for @ref{findPaths}
+	 * and @ref{addPathWaypoints}.
+	 */
+	std::vector<Waypoint*> findPath(Waypoint& from, Waypoint& to) const;
+	
+	/**
+	 * Find the shortest paths @ref{from} to all of the @ref{targets} in a single search. Not thread safe, see @ref{findPath}.
+	 * @param paths For every target the path to it will be stored here, in the same order. A path is empty if
+	 * the target cannot be reached.
+	 */
+	void findPaths(Waypoint& from, const std::vector<Waypoint*>& targets, std::vector<std::vector<Waypoint*> >& paths) const;
+	
+	/**
+	 * Add the waypoints on the shortest paths @ref{from} to all of the @ref{targets} to @ref{waypoints}, using a single
+	 * search and without building the paths (see @ref{findPaths}). Not thread safe, see @ref{findPath}.
+	 * @return The number of targets that can be reached.
 	 */
-	std::vector<Waypoint*> findPath(Waypoint& from, Waypoint& to, const std::vector<Waypoint*>& all_waypoints) const;
+	unsigned int addPathWaypoints(Waypoint& from, const std::vector<Waypoint*>& targets, std::set<Waypoint*>& waypoints) const;
 	
 	/**
 	 * Check if the we can see @ref{point} from @ref{location}, we allow a wall to
@@ -80,8 +140,19 @@ public:
 	 */
 	bool isFullyConnected(Waypoint& enter_waypoint, Waypoint& exit_waypoint, const std::vector<Waypoint*>& waypoints, const std::vector<Waypoint*>& inspection_points, std::vector<Waypoint*>& unconnected_inspection_points);
 	
+	/**
+	 * Check if all the @ref{faces} and @ref{view_points} can be observed and all the @ref{view_cones} can be reached from
+	 * @ref{enter_waypoint}. The connectivity is kept between calls, so waypoints that have been passed before are not
+	 * tested again; the waypoints must therefore not be deleted while this scene exists.
+	 */
 	bool isFullyConnected(Waypoint& enter_waypoint, Waypoint& exit_waypoint, const std::vector<Waypoint*>& waypoints, const std::vector<Waypoint*>& view_cones, const std::vector<Vector2D>& view_points, const std::vector<const Face*>& faces, std::vector<Waypoint*>& unconnected_inspection_points);
 	
+	/**
+	 * Connect every pair of @ref{waypoints} that can be connected in this scene (see @ref{canConnect}) by an edge. The
+	 * previous edges of the waypoints are removed.
+	 */
+	void connectWaypoints(const std::vector<Waypoint*>& waypoints) const;
+	
 	/**
 	 * Check if the given point is accessable and not too close to any walls.
 	 * @param point The point we want to check on the map.
@@ -96,17 +167,53 @@ public:
 	 * @return The Face object if it was found, NULL otherwise.
 	 */
 	const Face* getFace(const std::string& face_name) const;
+	
+	static const ShapeQueryCache& getShapeQueryCache() { return shape_query_cache_; }
 private:
+	/**
+	 * A scene owns its face grid, waypoint search, connectivity and distance field, so it cannot be copied.
+	 * These are declared but never implemented.
+	 */
+	Scene(const Scene& scene);
+	Scene& operator=(const Scene& scene);
+
 	void loadShapes(const std::string& object_name);
 	
+	/**
+	 * Register the shapes of this scene with @ref{shape_query_cache_}.
+	 */
+	void addShapesToCache();
+	
+	/**
+	 * Check if the line segment from @ref{from} to @ref{to} is at least @ref{distance} away from any obstacle
+	 * on the occupancy grid.
+	 */
+	bool isFreeOnMap(const Vector2D& from, const Vector2D& to, float distance) const;
+	
+	/**
+	 * Check if any shape is closer than @ref{distance} to the line segment from @ref{from} to @ref{to}. Only the shapes
+	 * with a face in the cells of @ref{face_grid_} near the segment are tested, using the results of the other scenes
+	 * that contain the same shapes.
+	 */
+	bool isNearSegment(const Vector2D& from, const Vector2D& to, float distance) const;
+	
 	OntolAccess* oa_;
 	std::string ontology_name_;
 	OccupancyGridFunction* occupancy_grid_function_;
 	float probability_;
 	
 	std::vector<Shape*> shapes_;
+	FaceGrid* face_grid_; // Spatial index over the faces of shapes_, used by all the geometric queries.
+	std::vector<unsigned long long> shape_set_; // The ids of shapes_ in shape_query_cache_, see ShapeQueryCache::ShapeSet.
+	std::vector<unsigned int> face_shape_ids_;  // For every face in face_grid_, the id of its shape in shape_query_cache_.
+	WaypointSearch* waypoint_search_;     // The nodes and the queue of findPath, reused by every search (so not thread safe).
+	WaypointConnectivity* connectivity_;  // The components of the waypoints seen by isFullyConnected.
+	DistanceField* distance_field_;       // The distance to the faces of shapes_, used by isBlocked and isAccessible.
 	
 	static std::map<std::string, std::vector<Shape*>* > object_in_scene_cache_;
+	static ShapeQueryCache shape_query_cache_; // Line segment queries shared by all the scenes.
+	static float distance_field_resolution_;
+	static pthread_mutex_t occupancy_grid_mutex_; // The occupancy grid is not known to be thread safe, so all the scenes take turns.
 	
 	friend std::ostream& operator<<(std::ostream& os, const Scene& scene);
 };
@@ -0,0 +1,443 @@
+#include <turtlebot_planner/Ontology/SceneFile.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <turtlebot_planner/Ontology/Scene.h>
+#include <turtlebot_planner/Ontology/Shape.h>
+#include <turtlebot_planner/Ontology/Face.h>
+#include <turtlebot_planner/Ontology/RotationMatrix.h>
+
+// The last two characters are the version of the format, a snapshot of another version is not loaded.
+static const char SNAPSHOT_MAGIC[8] = { 'S', 'C', 'E', 'N', 'E', 'S', '0', '2' };
+static const unsigned int SNAPSHOT_VERSION_OFFSET = 6;
+
+struct SnapshotHeader
+{
+	char magic_[8];
+	uint64_t checksum_; // Of everything after the header, see addToChecksum.
+	uint32_t source_;   // The name of the source of the scenes.
+	uint32_t nr_scenes_;
+	uint32_t nr_shapes_;
+	uint32_t nr_faces_;
+	uint32_t names_size_;
+	uint32_t padding_;  // Always 0, so headers can be compared with memcmp.
+};
+
+struct SnapshotScene
+{
+	uint32_t name_;
+	float probability_;
+	uint32_t first_shape_;
+	uint32_t nr_shapes_;
+};
+
+struct SnapshotShape
+{
+	uint32_t name_;
+	float x_, y_, z_;
+	uint32_t is_target_;
+	uint32_t first_face_;
+	uint32_t nr_faces_;
+};
+
+// The faces are stored as one array per field, in this order.
+enum SNAPSHOT_FACE_FIELD { X1, Y1, Z1, X2, Y2, Z2, NORMAL_X, NORMAL_Y, NORMAL_Z, HUE, SATURATION, VALUE, IS_OBSERVED, NAME, NR_FACE_FIELDS };
+
+/**
+ * Add @ref{name} to @ref{names}.
+ * @return The offset of the name in @ref{names}.
+ */
+static uint32_t addName(std::string& names, const std::string& name)
+{
+	uint32_t offset = names.size();
+	names.append(name.c_str(), name.size() + 1);
+	return offset;
+}
+
+/**
+ * Add @ref{size} bytes at @ref{data} to the 64-bit FNV-1a hash @ref{checksum}.
+ * @return The new checksum.
+ */
+static uint64_t addToChecksum(uint64_t checksum, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		checksum = (checksum ^ bytes[i]) * 1099511628211ULL;
+	}
+	return checksum;
+}
+
+static const uint64_t EMPTY_CHECKSUM = 14695981039346656037ULL;
+
+bool SceneFile::load(const std::string& file_name, OccupancyGridFunction* occupancy_grid_function, std::vector<Scene*>& scenes, const std::string& source)
+{
+	std::ifstream file(file_name.c_str());
+	if (!file.is_open())
+	{
+		std::cerr << "[SceneFile::load] Could not open: " << file_name << "." << std::endl;
+		return false;
+	}
+	
+	char magic[sizeof(SNAPSHOT_MAGIC)];
+	if (file.read(magic, sizeof(magic)) && memcmp(magic, SNAPSHOT_MAGIC, SNAPSHOT_VERSION_OFFSET) == 0)
+	{
+		file.close();
+		return loadSnapshot(file_name, occupancy_grid_function, scenes, source);
+	}
+	file.clear();
+	file.seekg(0);
+	
+	// The faces are stored in the global frame, relative to their shape.
+	RotationMatrix identity(1, 0, 0, 1);
+	
+	std::string scene_name;
+	float probability = 1;
+	std::vector<Shape*> shapes;
+	bool has_scene = false;
+	unsigned int nr_previous_scenes = scenes.size();
+	
+	std::string line;
+	unsigned int line_nr = 0;
+	while (std::getline(file, line))
+	{
+		++line_nr;
+		std::stringstream ss(line);
+		std::string type;
+		if (!(ss >> type) || type[0] == '#')
+		{
+			continue;
+		}
+		
+		if (type == "scene")
+		{
+			if (has_scene)
+			{
+				scenes.push_back(new Scene(scene_name, shapes, probability, occupancy_grid_function));
+				shapes.clear();
+			}
+			ss >> scene_name >> probability;
+			has_scene = true;
+		}
+		else if (type == "shape" && has_scene)
+		{
+			std::string shape_name;
+			float x, y, z;
+			bool is_target;
+			ss >> shape_name >> x >> y >> z >> is_target;
+			shapes.push_back(new Shape(shape_name, Vector3D(x, y, z), identity, is_target));
+		}
+		else if (type == "face" && !shapes.empty())
+		{
+			std::string face_name;
+			float x1, y1, z1, x2, y2, z2, normal_x, normal_y, normal_z;
+			int hue, saturation, value;
+			bool is_observed;
+			ss >> face_name >> x1 >> y1 >> z1 >> x2 >> y2 >> z2 >> normal_x >> normal_y >> normal_z >> hue >> saturation >> value >> is_observed;
+			
+			// Faces are registered globally, so a malformed face must not be.
+			if (!ss.fail())
+			{
+				Shape& shape = *shapes.back();
+				Face face(shape, face_name, Vector3D(x1, y1, z1), Vector3D(x2, y2, z2), Vector3D(normal_x, normal_y, normal_z), hue, saturation, value, is_observed);
+				const Face* stored_face = Face::getFace(shape, face, is_observed);
+				if (stored_face != NULL)
+				{
+					shape.addFace(*stored_face);
+				}
+			}
+		}
+		else
+		{
+			std::cerr << "[SceneFile::load] Ignore line " << line_nr << " of " << file_name << ": " << line << std::endl;
+			continue;
+		}
+		
+		if (ss.fail())
+		{
+			std::cerr << "[SceneFile::load] Malformed line " << line_nr << " of " << file_name << ": " << line << std::endl;
+			
+			// Do not leave a partial set of scenes behind; the scenes delete their own shapes.
+			for (std::vector<Shape*>::const_iterator ci = shapes.begin(); ci != shapes.end(); ++ci)
+			{
+				delete *ci;
+			}
+			for (std::vector<Scene*>::const_iterator ci = scenes.begin() + nr_previous_scenes; ci != scenes.end(); ++ci)
+			{
+				delete *ci;
+			}
+			scenes.resize(nr_previous_scenes);
+			return false;
+		}
+	}
+	
+	if (has_scene)
+	{
+		scenes.push_back(new Scene(scene_name, shapes, probability, occupancy_grid_function));
+	}
+	return true;
+}
+
+bool SceneFile::save(const std::string& file_name, const std::vector<Scene*>& scenes)
+{
+	std::ofstream file(file_name.c_str());
+	if (!file.is_open())
+	{
+		std::cerr << "[SceneFile::save] Could not open: " << file_name << "." << std::endl;
+		return false;
+	}
+	file.precision(9);
+	
+	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci)
+	{
+		const Scene* scene = *ci;
+		file << "scene " << (scene->getName().empty() ? "scene" : scene->getName()) << " " << scene->getProbability() << std::endl;
+		for (std::vector<Shape*>::const_iterator ci = scene->getShapes().begin(); ci != scene->getShapes().end(); ++ci)
+		{
+			const Shape* shape = *ci;
+			const Vector3D& location = shape->getLocation();
+			file << "shape " << (shape->getOntologyName().empty() ? "shape" : shape->getOntologyName()) << " " << location.x_ << " " << location.y_ << " " << location.z_ << " " << shape->isTarget() << std::endl;
+			for (std::vector<const Face*>::const_iterator ci = shape->getFaces().begin(); ci != shape->getFaces().end(); ++ci)
+			{
+				const Face* face = *ci;
+				Vector3D p1 = face->getP1() - location;
+				Vector3D p2 = face->getP2() - location;
+				file << "face " << (face->getName().empty() ? "face" : face->getName()) << " " << p1.x_ << " " << p1.y_ << " " << p1.z_ << " " << p2.x_ << " " << p2.y_ << " " << p2.z_ << " " << face->getNormal().x_ << " " << face->getNormal().y_ << " " << face->getNormal().z_ << " " << face->getHue() << " " << face->getSaturation() << " " << face->getValue() << " " << face->isObserved() << std::endl;
+			}
+		}
+	}
+	return true;
+}
+
+bool SceneFile::saveSnapshot(const std::string& file_name, const std::vector<Scene*>& scenes, const std::string& source)
+{
+	SnapshotHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic_, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	std::vector<SnapshotScene> snapshot_scenes;
+	std::vector<SnapshotShape> snapshot_shapes;
+	std::vector<uint32_t> face_fields[NR_FACE_FIELDS];
+	std::string names;
+	header.source_ = addName(names, source);
+	
+	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci)
+	{
+		const Scene* scene = *ci;
+		SnapshotScene snapshot_scene;
+		snapshot_scene.name_ = addName(names, scene->getName());
+		snapshot_scene.probability_ = scene->getProbability();
+		snapshot_scene.first_shape_ = snapshot_shapes.size();
+		snapshot_scene.nr_shapes_ = scene->getShapes().size();
+		snapshot_scenes.push_back(snapshot_scene);
+		
+		for (std::vector<Shape*>::const_iterator ci = scene->getShapes().begin(); ci != scene->getShapes().end(); ++ci)
+		{
+			const Shape* shape = *ci;
+			SnapshotShape snapshot_shape;
+			snapshot_shape.name_ = addName(names, shape->getOntologyName());
+			snapshot_shape.x_ = shape->getLocation().x_;
+			snapshot_shape.y_ = shape->getLocation().y_;
+			snapshot_shape.z_ = shape->getLocation().z_;
+			snapshot_shape.is_target_ = shape->isTarget();
+			snapshot_shape.first_face_ = face_fields[X1].size();
+			snapshot_shape.nr_faces_ = shape->getFaces().size();
+			snapshot_shapes.push_back(snapshot_shape);
+			
+			for (std::vector<const Face*>::const_iterator ci = shape->getFaces().begin(); ci != shape->getFaces().end(); ++ci)
+			{
+				const Face* face = *ci;
+				float coordinates[] = { face->getP1().x_, face->getP1().y_, face->getP1().z_, face->getP2().x_, face->getP2().y_, face->getP2().z_, face->getNormal().x_, face->getNormal().y_, face->getNormal().z_ };
+				for (unsigned int field = X1; field <= NORMAL_Z; ++field)
+				{
+					uint32_t bits;
+					memcpy(&bits, &coordinates[field], sizeof(bits));
+					face_fields[field].push_back(bits);
+				}
+				face_fields[HUE].push_back(face->getHue());
+				face_fields[SATURATION].push_back(face->getSaturation());
+				face_fields[VALUE].push_back(face->getValue());
+				face_fields[IS_OBSERVED].push_back(face->isObserved());
+				face_fields[NAME].push_back(addName(names, face->getName()));
+			}
+		}
+	}
+	header.nr_scenes_ = snapshot_scenes.size();
+	header.nr_shapes_ = snapshot_shapes.size();
+	header.nr_faces_ = face_fields[X1].size();
+	header.names_size_ = names.size();
+	
+	// The checksum covers the data in the order it is written.
+	header.checksum_ = EMPTY_CHECKSUM;
+	if (!snapshot_scenes.empty())
+	{
+		header.checksum_ = addToChecksum(header.checksum_, &snapshot_scenes[0], snapshot_scenes.size() * sizeof(SnapshotScene));
+	}
+	if (!snapshot_shapes.empty())
+	{
+		header.checksum_ = addToChecksum(header.checksum_, &snapshot_shapes[0], snapshot_shapes.size() * sizeof(SnapshotShape));
+	}
+	for (unsigned int field = 0; field < NR_FACE_FIELDS && header.nr_faces_ > 0; ++field)
+	{
+		header.checksum_ = addToChecksum(header.checksum_, &face_fields[field][0], header.nr_faces_ * sizeof(uint32_t));
+	}
+	header.checksum_ = addToChecksum(header.checksum_, names.data(), names.size());
+	
+	// Do not write the same scenes again, a header with the same checksum and sizes holds them already.
+	SnapshotHeader existing_header;
+	std::ifstream existing_file(file_name.c_str(), std::ios::binary);
+	if (existing_file.read(reinterpret_cast<char*>(&existing_header), sizeof(existing_header)) && memcmp(&existing_header, &header, sizeof(header)) == 0)
+	{
+		return true;
+	}
+	existing_file.close();
+	
+	std::string tmp_file_name = file_name + ".tmp";
+	std::ofstream file(tmp_file_name.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "[SceneFile::saveSnapshot] Could not open: " << tmp_file_name << "." << std::endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!snapshot_scenes.empty())
+	{
+		file.write(reinterpret_cast<const char*>(&snapshot_scenes[0]), snapshot_scenes.size() * sizeof(SnapshotScene));
+	}
+	if (!snapshot_shapes.empty())
+	{
+		file.write(reinterpret_cast<const char*>(&snapshot_shapes[0]), snapshot_shapes.size() * sizeof(SnapshotShape));
+	}
+	for (unsigned int field = 0; field < NR_FACE_FIELDS && header.nr_faces_ > 0; ++field)
+	{
+		file.write(reinterpret_cast<const char*>(&face_fields[field][0]), header.nr_faces_ * sizeof(uint32_t));
+	}
+	file.write(names.data(), names.size());
+	file.close();
+	
+	if (file.fail() || rename(tmp_file_name.c_str(), file_name.c_str()) != 0)
+	{
+		std::cerr << "[SceneFile::saveSnapshot] Could not write: " << file_name << "." << std::endl;
+		remove(tmp_file_name.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool SceneFile::loadSnapshot(const std::string& file_name, OccupancyGridFunction* occupancy_grid_function, std::vector<Scene*>& scenes, const std::string& source)
+{
+	int fd = open(file_name.c_str(), O_RDONLY);
+	struct stat file_stat;
+	if (fd == -1 || fstat(fd, &file_stat) == -1 || file_stat.st_size < (off_t)sizeof(SnapshotHeader))
+	{
+		std::cerr << "[SceneFile::loadSnapshot] Could not read: " << file_name << "." << std::endl;
+		if (fd != -1)
+		{
+			close(fd);
+		}
+		return false;
+	}
+	
+	size_t size = file_stat.st_size;
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		std::cerr << "[SceneFile::loadSnapshot] Could not map: " << file_name << "." << std::endl;
+		return false;
+	}
+	
+	const SnapshotHeader* header = static_cast<const SnapshotHeader*>(data);
+	if (memcmp(header->magic_, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+	{
+		std::cerr << "[SceneFile::loadSnapshot] " << file_name << " is a snapshot of version " << std::string(header->magic_ + SNAPSHOT_VERSION_OFFSET, 2) << ", not " << std::string(SNAPSHOT_MAGIC + SNAPSHOT_VERSION_OFFSET, 2) << "." << std::endl;
+		munmap(data, size);
+		return false;
+	}
+	
+	// Check that all the arrays and references are within the file before anything is created.
+	const SnapshotScene* snapshot_scenes = reinterpret_cast<const SnapshotScene*>(header + 1);
+	const SnapshotShape* snapshot_shapes = reinterpret_cast<const SnapshotShape*>(snapshot_scenes + header->nr_scenes_);
+	const uint32_t* face_data = reinterpret_cast<const uint32_t*>(snapshot_shapes + header->nr_shapes_);
+	const char* names = reinterpret_cast<const char*>(face_data + (size_t)header->nr_faces_ * NR_FACE_FIELDS);
+	bool is_valid = sizeof(SnapshotHeader) + (size_t)header->nr_scenes_ * sizeof(SnapshotScene) + (size_t)header->nr_shapes_ * sizeof(SnapshotShape) +
+	                (size_t)header->nr_faces_ * NR_FACE_FIELDS * sizeof(uint32_t) + header->names_size_ == size &&
+	                header->source_ < header->names_size_ && names[header->names_size_ - 1] == '\0' &&
+	                addToChecksum(EMPTY_CHECKSUM, header + 1, size - sizeof(SnapshotHeader)) == header->checksum_;
+	for (unsigned int i = 0; is_valid && i < header->nr_scenes_; ++i)
+	{
+		is_valid = snapshot_scenes[i].name_ < header->names_size_ &&
+		           snapshot_scenes[i].first_shape_ <= header->nr_shapes_ && snapshot_scenes[i].nr_shapes_ <= header->nr_shapes_ - snapshot_scenes[i].first_shape_;
+	}
+	for (unsigned int i = 0; is_valid && i < header->nr_shapes_; ++i)
+	{
+		is_valid = snapshot_shapes[i].name_ < header->names_size_ &&
+		           snapshot_shapes[i].first_face_ <= header->nr_faces_ && snapshot_shapes[i].nr_faces_ <= header->nr_faces_ - snapshot_shapes[i].first_face_;
+	}
+	const uint32_t* face_names = face_data + (size_t)NAME * header->nr_faces_;
+	for (unsigned int i = 0; is_valid && i < header->nr_faces_; ++i)
+	{
+		is_valid = face_names[i] < header->names_size_;
+	}
+	if (!is_valid)
+	{
+		std::cerr << "[SceneFile::loadSnapshot] Malformed snapshot: " << file_name << "." << std::endl;
+		munmap(data, size);
+		return false;
+	}
+	if (!source.empty() && source != &names[header->source_])
+	{
+		std::cerr << "[SceneFile::loadSnapshot] " << file_name << " holds the scenes of " << &names[header->source_] << ", not of " << source << "." << std::endl;
+		munmap(data, size);
+		return false;
+	}
+	
+	const float* coordinates[NORMAL_Z + 1];
+	for (unsigned int field = X1; field <= NORMAL_Z; ++field)
+	{
+		coordinates[field] = reinterpret_cast<const float*>(face_data + (size_t)field * header->nr_faces_);
+	}
+	const uint32_t* hues = face_data + (size_t)HUE * header->nr_faces_;
+	const uint32_t* saturations = face_data + (size_t)SATURATION * header->nr_faces_;
+	const uint32_t* values = face_data + (size_t)VALUE * header->nr_faces_;
+	const uint32_t* is_observed = face_data + (size_t)IS_OBSERVED * header->nr_faces_;
+	
+	// The faces are stored in the global frame, the shapes are not rotated.
+	RotationMatrix identity(1, 0, 0, 1);
+	for (unsigned int scene_nr = 0; scene_nr < header->nr_scenes_; ++scene_nr)
+	{
+		const SnapshotScene& snapshot_scene = snapshot_scenes[scene_nr];
+		std::vector<Shape*> shapes;
+		for (unsigned int shape_nr = snapshot_scene.first_shape_; shape_nr < snapshot_scene.first_shape_ + snapshot_scene.nr_shapes_; ++shape_nr)
+		{
+			const SnapshotShape& snapshot_shape = snapshot_shapes[shape_nr];
+			Vector3D location(snapshot_shape.x_, snapshot_shape.y_, snapshot_shape.z_);
+			Shape* shape = new Shape(&names[snapshot_shape.name_], location, identity, snapshot_shape.is_target_ != 0);
+			shapes.push_back(shape);
+			
+			for (unsigned int i = snapshot_shape.first_face_; i < snapshot_shape.first_face_ + snapshot_shape.nr_faces_; ++i)
+			{
+				Vector3D p1(coordinates[X1][i], coordinates[Y1][i], coordinates[Z1][i]);
+				Vector3D p2(coordinates[X2][i], coordinates[Y2][i], coordinates[Z2][i]);
+				Vector3D normal(coordinates[NORMAL_X][i], coordinates[NORMAL_Y][i], coordinates[NORMAL_Z][i]);
+				Face face(*shape, &names[face_names[i]], p1 - location, p2 - location, normal, hues[i], saturations[i], values[i], is_observed[i] != 0);
+				const Face* stored_face = Face::getFace(*shape, face, is_observed[i] != 0);
+				if (stored_face != NULL)
+				{
+					shape->addFace(*stored_face);
+				}
+			}
+		}
+		scenes.push_back(new Scene(&names[snapshot_scene.name_], shapes, snapshot_scene.probability_, occupancy_grid_function));
+	}
+	munmap(data, size);
+	return true;
+}
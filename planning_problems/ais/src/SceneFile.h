@@ -0,0 +1,64 @@
+#ifndef TURTLEBOT_PLANNER_ONTOLOGY_SCENE_FILE_H
+#define TURTLEBOT_PLANNER_ONTOLOGY_SCENE_FILE_H
+
+#include <string>
+#include <vector>
+
+class Scene;
+class OccupancyGridFunction;
+
+/**
+ * Stores scenes in a text file, so they can be loaded without the ontology. Every line describes one
+ * element and belongs to the scene or shape that was declared last:
+ *
+ *   scene <name> <probability>
+ *   shape <name> <x> <y> <z> <is target>
+ *   face <name> <x1> <y1> <z1> <x2> <y2> <z2> <normal x> <normal y> <normal z> <hue> <saturation> <value> <is observed>
+ *
+ * The corners of a face are relative to the location of its shape, the normal is in the global frame.
+ * Names cannot contain white space. Empty lines and lines starting with '#' are ignored.
+ *
+ * The same scenes can be stored as a binary snapshot (see @ref{saveSnapshot}), which is memory mapped when it is
+ * loaded instead of parsed. A snapshot starts with a header (the magic "SCENES02", whose last two characters are the
+ * version of the format, a checksum of the rest of the file, the source of the scenes, the number of scenes, shapes
+ * and faces and the size of the names), followed by the scenes (name, probability, first shape, number of shapes),
+ * the shapes (name, location, is target, first face, number of faces), the faces as one array per field (the corners
+ * in the global frame, the normal, the colour, is observed and the name) and finally all the names, each terminated
+ * by a '\0'. Names are offsets into these names and all the fields are 4 bytes in the byte order of the machine that
+ * wrote the snapshot.
+ */
+class SceneFile
+{
+public:
+	/**
+	 * Load all the scenes from @ref{file_name}, which is either a text file or a snapshot. The faces are registered with @ref{Face::getFace} like the
+	 * faces of the ontology are.
+	 * @param occupancy_grid_function The map of the scenes, NULL if only the shapes are obstacles.
+	 * @param scenes The loaded scenes will be added here. Nothing is added if the file cannot be read.
+	 * @param source If not empty, a snapshot is only loaded if it was written with the same source (see @ref{saveSnapshot}).
+	 * @return True if the file could be read, false otherwise.
+	 */
+	static bool load(const std::string& file_name, OccupancyGridFunction* occupancy_grid_function, std::vector<Scene*>& scenes, const std::string& source = "");
+	
+	/**
+	 * Write @ref{scenes} to @ref{file_name}.
+	 * @return True if the file could be written, false otherwise.
+	 */
+	static bool save(const std::string& file_name, const std::vector<Scene*>& scenes);
+	
+	/**
+	 * Write @ref{scenes} to @ref{file_name} as a binary snapshot. The snapshot is written to a temporary file first and
+	 * then renamed, so a process that loads @ref{file_name} at the same time never sees a partial snapshot. Nothing is
+	 * written if @ref{file_name} already holds the same scenes of the same source.
+	 * @param source Where the scenes came from, e.g. the name of the map; a snapshot is not loaded for another source.
+	 * @return True if the snapshot is up to date, false otherwise.
+	 */
+	static bool saveSnapshot(const std::string& file_name, const std::vector<Scene*>& scenes, const std::string& source);
+private:
+	/**
+	 * Load all the scenes from the snapshot @ref{file_name}, see @ref{load}.
+	 */
+	static bool loadSnapshot(const std::string& file_name, OccupancyGridFunction* occupancy_grid_function, std::vector<Scene*>& scenes, const std::string& source);
+};
+
+#endif
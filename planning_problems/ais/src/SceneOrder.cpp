@@ -0,0 +1,241 @@
+#include <turtlebot_planner/Ontology/SceneOrder.h>
+
+#include <algorithm>
+#include <math.h>
+
+/**
+ * Orders the scenes by their failures in a region, then by their failures in all the regions, then by their index.
+ */
+struct SceneFailureComparator
+{
+	SceneFailureComparator(const std::vector<unsigned int>& failures, const std::vector<unsigned int>& all_failures)
+		: failures_(&failures), all_failures_(&all_failures)
+	{
+
+	}
+
+	bool operator()(unsigned int lhs, unsigned int rhs) const
+	{
+		if ((*failures_)[lhs] != (*failures_)[rhs]) return (*failures_)[lhs] > (*failures_)[rhs];
+		if ((*all_failures_)[lhs] != (*all_failures_)[rhs]) return (*all_failures_)[lhs] > (*all_failures_)[rhs];
+		return lhs < rhs;
+	}
+
+	const std::vector<unsigned int>* failures_;
+	const std::vector<unsigned int>* all_failures_;
+};
+
+SceneOrder::SceneOrder(float cell_size)
+	: cell_size_(cell_size), generation_(0)
+{
+	pthread_mutex_init(&mutex_, NULL);
+	pthread_key_create(&statistics_key_, mergeStatistics);
+	shared_.scene_order_ = this;
+	clear(shared_, 0);
+}
+
+SceneOrder::~SceneOrder()
+{
+	// The statistics of the threads that still run are not merged anymore.
+	delete static_cast<Statistics*>(pthread_getspecific(statistics_key_));
+	pthread_key_delete(statistics_key_);
+	pthread_mutex_destroy(&mutex_);
+}
+
+void SceneOrder::reset(unsigned int nr_scenes)
+{
+	pthread_mutex_lock(&mutex_);
+	clear(shared_, nr_scenes);
+	++generation_;
+	pthread_mutex_unlock(&mutex_);
+}
+
+void SceneOrder::clear(Statistics& statistics, unsigned int nr_scenes)
+{
+	statistics.regions_.clear();
+	statistics.all_regions_.failures_.assign(nr_scenes, 0);
+	statistics.all_regions_.new_failures_.assign(nr_scenes, 0);
+	statistics.all_regions_.order_.clear();
+	for (unsigned int i = 0; i < nr_scenes; ++i)
+	{
+		statistics.all_regions_.order_.push_back(i);
+	}
+	statistics.nr_checks_ = 0;
+	statistics.nr_tests_ = 0;
+	statistics.nr_failures_ = 0;
+	statistics.nr_first_scene_failures_ = 0;
+	statistics.nr_unmerged_failures_ = 0;
+}
+
+const std::vector<unsigned int>& SceneOrder::getOrder(const Vector2D& point, unsigned int nr_scenes)
+{
+	Statistics& statistics = getStatistics();
+	if (statistics.all_regions_.order_.size() != nr_scenes)
+	{
+		clear(statistics, nr_scenes);
+	}
+	std::map<RegionKey, Region>::const_iterator ci = statistics.regions_.find(getRegionKey(point));
+
+	// A region without failures uses the order of all the regions.
+	return ci != statistics.regions_.end() ? (*ci).second.order_ : statistics.all_regions_.order_;
+}
+
+void SceneOrder::addResult(const Vector2D& point, int failed_scene, unsigned int nr_tests)
+{
+	Statistics& statistics = getStatistics();
+	++statistics.nr_checks_;
+	statistics.nr_tests_ += nr_tests;
+	if (failed_scene == -1 || (unsigned int)failed_scene >= statistics.all_regions_.failures_.size())
+	{
+		return;
+	}
+
+	++statistics.nr_failures_;
+	if (nr_tests == 1)
+	{
+		++statistics.nr_first_scene_failures_;
+	}
+
+	Region& all_regions = statistics.all_regions_;
+	++all_regions.failures_[failed_scene];
+	++all_regions.new_failures_[failed_scene];
+	sortRegion(all_regions, all_regions);
+
+	Region& region = statistics.regions_[getRegionKey(point)];
+	if (region.failures_.empty())
+	{
+		region.failures_.assign(all_regions.failures_.size(), 0);
+		region.order_ = all_regions.order_;
+	}
+	if (region.new_failures_.empty())
+	{
+		region.new_failures_.assign(all_regions.failures_.size(), 0);
+	}
+	++region.failures_[failed_scene];
+	++region.new_failures_[failed_scene];
+	sortRegion(region, all_regions);
+
+	// Share the failures with the other threads and learn from theirs.
+	if (++statistics.nr_unmerged_failures_ >= MERGE_INTERVAL)
+	{
+		pthread_mutex_lock(&mutex_);
+		if (statistics.generation_ == generation_)
+		{
+			merge(statistics);
+			copyShared(statistics);
+		}
+		pthread_mutex_unlock(&mutex_);
+	}
+}
+
+SceneOrder::Statistics& SceneOrder::getStatistics()
+{
+	Statistics* statistics = static_cast<Statistics*>(pthread_getspecific(statistics_key_));
+	if (statistics == NULL)
+	{
+		statistics = new Statistics();
+		statistics->scene_order_ = this;
+		statistics->generation_ = generation_ - 1;
+		pthread_setspecific(statistics_key_, statistics);
+	}
+
+	// Start from the merged failures, but not the merged counters.
+	if (statistics->generation_ != generation_)
+	{
+		pthread_mutex_lock(&mutex_);
+		copyShared(*statistics);
+		pthread_mutex_unlock(&mutex_);
+		statistics->generation_ = generation_;
+	}
+	return *statistics;
+}
+
+void SceneOrder::merge(const Statistics& statistics)
+{
+	if (statistics.all_regions_.failures_.size() != shared_.all_regions_.failures_.size())
+	{
+		return;
+	}
+
+	shared_.nr_checks_ += statistics.nr_checks_;
+	shared_.nr_tests_ += statistics.nr_tests_;
+	shared_.nr_failures_ += statistics.nr_failures_;
+	shared_.nr_first_scene_failures_ += statistics.nr_first_scene_failures_;
+
+	unsigned int nr_scenes = shared_.all_regions_.failures_.size();
+	for (unsigned int i = 0; i < nr_scenes; ++i)
+	{
+		shared_.all_regions_.failures_[i] += statistics.all_regions_.new_failures_[i];
+	}
+	sortRegion(shared_.all_regions_, shared_.all_regions_);
+
+	for (std::map<RegionKey, Region>::const_iterator ci = statistics.regions_.begin(); ci != statistics.regions_.end(); ++ci)
+	{
+		const Region& region = (*ci).second;
+		if (region.new_failures_.empty())
+		{
+			continue;
+		}
+
+		Region& shared_region = shared_.regions_[(*ci).first];
+		if (shared_region.failures_.empty())
+		{
+			shared_region.failures_.assign(nr_scenes, 0);
+		}
+		for (unsigned int i = 0; i < nr_scenes; ++i)
+		{
+			shared_region.failures_[i] += region.new_failures_[i];
+		}
+		shared_region.order_ = shared_.all_regions_.order_;
+		sortRegion(shared_region, shared_.all_regions_);
+	}
+}
+
+void SceneOrder::copyShared(Statistics& statistics) const
+{
+	// The regions of shared_ have no new failures, so those of the copy start empty.
+	statistics.regions_ = shared_.regions_;
+	statistics.all_regions_ = shared_.all_regions_;
+	statistics.nr_checks_ = 0;
+	statistics.nr_tests_ = 0;
+	statistics.nr_failures_ = 0;
+	statistics.nr_first_scene_failures_ = 0;
+	statistics.nr_unmerged_failures_ = 0;
+}
+
+void SceneOrder::mergeStatistics(void* data)
+{
+	Statistics* statistics = static_cast<Statistics*>(data);
+	SceneOrder& scene_order = *statistics->scene_order_;
+	pthread_mutex_lock(&scene_order.mutex_);
+	if (statistics->generation_ == scene_order.generation_)
+	{
+		scene_order.merge(*statistics);
+	}
+	pthread_mutex_unlock(&scene_order.mutex_);
+	delete statistics;
+}
+
+unsigned int SceneOrder::getTotal(unsigned int Statistics::*counter) const
+{
+	pthread_mutex_lock(&mutex_);
+	unsigned int total = shared_.*counter;
+	pthread_mutex_unlock(&mutex_);
+
+	const Statistics* statistics = static_cast<const Statistics*>(pthread_getspecific(statistics_key_));
+	if (statistics != NULL && statistics->generation_ == generation_)
+	{
+		total += statistics->*counter;
+	}
+	return total;
+}
+
+SceneOrder::RegionKey SceneOrder::getRegionKey(const Vector2D& point) const
+{
+	return std::make_pair((int)floor(point.x_ / cell_size_), (int)floor(point.y_ / cell_size_));
+}
+
+void SceneOrder::sortRegion(Region& region, const Region& all_regions)
+{
+	std::sort(region.order_.begin(), region.order_.end(), SceneFailureComparator(region.failures_, all_regions.failures_));
+}
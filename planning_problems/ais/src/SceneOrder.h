@@ -0,0 +1,137 @@
+#ifndef TURTLEBOT_PLANNER_ONTOLOGY_SCENE_ORDER_H
+#define TURTLEBOT_PLANNER_ONTOLOGY_SCENE_ORDER_H
+
+#include <vector>
+#include <map>
+#include <pthread.h>
+
+#include "Vector2D.h"
+
+/**
+ * Many checks must hold in all the scenes (e.g. a waypoint must be accessible in every scene) and stop at the first
+ * scene in which they fail. This class chooses the order in which the scenes are tested, such that the scene that is
+ * most likely to fail is tested first. For every region of a uniform grid it counts how often each scene failed a
+ * check in that region; the scenes are ordered by these counts, then by their failures anywhere, then by their index.
+ *
+ * Every thread keeps its own failures and orders, so a check neither takes a lock nor copies an order. A thread
+ * starts with the shared failures and adds its own failures to them every @ref{MERGE_INTERVAL} failures and when it
+ * ends; at every merge it continues from the shared failures, which include those of the other threads.
+ */
+class SceneOrder
+{
+public:
+	/**
+	 * @param cell_size The width and height of a region.
+	 */
+	SceneOrder(float cell_size = 2.0f);
+	~SceneOrder();
+
+	/**
+	 * Forget all the failures and counters, e.g. because the scenes have been reloaded. No check may run meanwhile.
+	 * @param nr_scenes The number of scenes.
+	 */
+	void reset(unsigned int nr_scenes);
+
+	/**
+	 * Get the order in which the scenes are tested by a check at @ref{point}.
+	 * @param nr_scenes The number of scenes, if this differs from the number given to @ref{reset} the failures of the
+	 * calling thread are forgotten.
+	 * @return The indices of all the scenes, the scene that is most likely to fail first. The order belongs to the
+	 * calling thread and is valid until its next call of @ref{addResult}.
+	 */
+	const std::vector<unsigned int>& getOrder(const Vector2D& point, unsigned int nr_scenes);
+
+	/**
+	 * Record the result of a check at @ref{point}.
+	 * @param failed_scene The index of the scene in which the check failed, -1 if it held in all the scenes.
+	 * @param nr_tests The number of scenes that were tested.
+	 */
+	void addResult(const Vector2D& point, int failed_scene, unsigned int nr_tests);
+
+	/**
+	 * The counters include the checks of the calling thread and those the other threads have merged.
+	 */
+	unsigned int getNumberOfChecks() const { return getTotal(&Statistics::nr_checks_); }
+	unsigned int getNumberOfTests() const { return getTotal(&Statistics::nr_tests_); }
+	unsigned int getNumberOfFailures() const { return getTotal(&Statistics::nr_failures_); }
+
+	/**
+	 * @return The number of failed checks for which the first scene that was tested failed.
+	 */
+	unsigned int getNumberOfFirstSceneFailures() const { return getTotal(&Statistics::nr_first_scene_failures_); }
+private:
+	// The number of failures after which a thread merges its failures with those of the other threads.
+	static const unsigned int MERGE_INTERVAL = 100;
+
+	struct Region
+	{
+		std::vector<unsigned int> failures_;     // For every scene the number of checks in this region it failed.
+		std::vector<unsigned int> new_failures_; // The part of failures_ that was added by this thread.
+		std::vector<unsigned int> order_;        // The scenes ordered by their failures.
+	};
+
+	typedef std::pair<int, int> RegionKey;
+
+	/**
+	 * The failures and counters of a single thread, or those that the threads have merged.
+	 */
+	struct Statistics
+	{
+		SceneOrder* scene_order_;
+		unsigned int generation_;              // The value of generation_ of the scene order when these were copied.
+		std::map<RegionKey, Region> regions_;
+		Region all_regions_;                   // The failures of every scene in all the regions together.
+
+		unsigned int nr_checks_;
+		unsigned int nr_tests_;
+		unsigned int nr_failures_;
+		unsigned int nr_first_scene_failures_;
+		unsigned int nr_unmerged_failures_;    // The failures since the last merge.
+	};
+
+	RegionKey getRegionKey(const Vector2D& point) const;
+
+	/**
+	 * Forget all the failures and counters of @ref{statistics}.
+	 */
+	static void clear(Statistics& statistics, unsigned int nr_scenes);
+
+	/**
+	 * Get the statistics of the calling thread, start them from @ref{shared_} if they do not exist yet or are older
+	 * than the last @ref{reset}.
+	 */
+	Statistics& getStatistics();
+
+	/**
+	 * Add the new failures and the counters of @ref{statistics} to @ref{shared_}. The caller holds @ref{mutex_}.
+	 */
+	void merge(const Statistics& statistics);
+
+	/**
+	 * Copy the failures of @ref{shared_} to @ref{statistics} and reset its counters. The caller holds @ref{mutex_}.
+	 */
+	void copyShared(Statistics& statistics) const;
+
+	/**
+	 * Add the failures and counters of a thread that ends to @ref{shared_} and delete them, see pthread_key_create.
+	 */
+	static void mergeStatistics(void* statistics);
+
+	/**
+	 * @return The sum of @ref{counter} of @ref{shared_} and of the calling thread.
+	 */
+	unsigned int getTotal(unsigned int Statistics::*counter) const;
+
+	/**
+	 * Sort the scenes of @ref{region} by their failures in @ref{region}, then by their failures in @ref{all_regions}.
+	 */
+	static void sortRegion(Region& region, const Region& all_regions);
+
+	float cell_size_;
+	pthread_key_t statistics_key_;         // The statistics of every thread.
+	Statistics shared_;                    // The statistics the threads have merged.
+	unsigned int generation_;              // The number of calls of reset.
+	mutable pthread_mutex_t mutex_;        // Guards shared_.
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include <turtlebot_planner/Ontology/SegmentKernel.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+// GCC does not vectorise the scalar blocks: it sinks the arithmetic of every lane into the branches of the clamps, and
+// floating point operations in a branch may trap, so the loop is not if-converted. On x86 we therefore test four
+// segments at a time with SSE. The operations are the same as those of the scalar functions in SegmentKernel.h, in
+// the same order, so both give the same results.
+
+/**
+ * The squared distances between the points (@ref{px}, @ref{py}) and the segments (@ref{ux}, @ref{uy}) - (@ref{vx}, @ref{vy}).
+ */
+static inline __m128 getSquaredDistances(__m128 px, __m128 py, __m128 ux, __m128 uy, __m128 vx, __m128 vy)
+{
+	__m128 dx = _mm_sub_ps(vx, ux);
+	__m128 dy = _mm_sub_ps(vy, uy);
+	__m128 length_squared = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+	length_squared = _mm_max_ps(length_squared, _mm_set1_ps(1e-12f));
+	__m128 t = _mm_div_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(px, ux), dx), _mm_mul_ps(_mm_sub_ps(py, uy), dy)), length_squared);
+	t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	__m128 ex = _mm_sub_ps(_mm_add_ps(ux, _mm_mul_ps(t, dx)), px);
+	__m128 ey = _mm_sub_ps(_mm_add_ps(uy, _mm_mul_ps(t, dy)), py);
+	return _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey));
+}
+
+/**
+ * The squared distances between the points (@ref{px}, @ref{py}, @ref{pz}) and the segments (@ref{ux}, @ref{uy}, @ref{uz}) - (@ref{vx}, @ref{vy}, @ref{vz}).
+ */
+static inline __m128 getSquaredDistances(__m128 px, __m128 py, __m128 pz, __m128 ux, __m128 uy, __m128 uz, __m128 vx, __m128 vy, __m128 vz)
+{
+	__m128 dx = _mm_sub_ps(vx, ux);
+	__m128 dy = _mm_sub_ps(vy, uy);
+	__m128 dz = _mm_sub_ps(vz, uz);
+	__m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+	length_squared = _mm_max_ps(length_squared, _mm_set1_ps(1e-12f));
+	__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(px, ux), dx), _mm_mul_ps(_mm_sub_ps(py, uy), dy)), _mm_mul_ps(_mm_sub_ps(pz, uz), dz));
+	t = _mm_div_ps(t, length_squared);
+	t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	__m128 ex = _mm_sub_ps(_mm_add_ps(ux, _mm_mul_ps(t, dx)), px);
+	__m128 ey = _mm_sub_ps(_mm_add_ps(uy, _mm_mul_ps(t, dy)), py);
+	__m128 ez = _mm_sub_ps(_mm_add_ps(uz, _mm_mul_ps(t, dz)), pz);
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), _mm_mul_ps(ez, ez));
+}
+
+/**
+ * The orientations (@ref{bx} - @ref{ax}, @ref{by} - @ref{ay}) x (@ref{cx} - @ref{ax}, @ref{cy} - @ref{ay}).
+ */
+static inline __m128 getOrientations(__m128 ax, __m128 ay, __m128 bx, __m128 by, __m128 cx, __m128 cy)
+{
+	return _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(bx, ax), _mm_sub_ps(cy, ay)), _mm_mul_ps(_mm_sub_ps(by, ay), _mm_sub_ps(cx, ax)));
+}
+
+/**
+ * Test the four segments (@ref{x1}, @ref{y1}) - (@ref{x2}, @ref{y2}) against the segment (@ref{ax}, @ref{ay}) - (@ref{bx}, @ref{by}).
+ * @return A bit mask of the segments whose squared distance is less than @ref{distance_squared}.
+ */
+static inline int findSegmentsWithin(const float* x1, const float* y1, const float* x2, const float* y2, __m128 ax, __m128 ay, __m128 bx, __m128 by, __m128 distance_squared)
+{
+	__m128 cx = _mm_loadu_ps(x1);
+	__m128 cy = _mm_loadu_ps(y1);
+	__m128 dx = _mm_loadu_ps(x2);
+	__m128 dy = _mm_loadu_ps(y2);
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 o1 = getOrientations(ax, ay, bx, by, cx, cy);
+	__m128 o2 = getOrientations(ax, ay, bx, by, dx, dy);
+	__m128 o3 = getOrientations(cx, cy, dx, dy, ax, ay);
+	__m128 o4 = getOrientations(cx, cy, dx, dy, bx, by);
+	__m128 not_collinear = _mm_or_ps(_mm_cmpneq_ps(o1, zero), _mm_cmpneq_ps(o2, zero));
+	__m128 crossing = _mm_and_ps(_mm_and_ps(_mm_cmple_ps(_mm_mul_ps(o1, o2), zero), _mm_cmple_ps(_mm_mul_ps(o3, o4), zero)), not_collinear);
+
+	__m128 d = getSquaredDistances(ax, ay, cx, cy, dx, dy);
+	d = _mm_min_ps(getSquaredDistances(bx, by, cx, cy, dx, dy), d);
+	d = _mm_min_ps(getSquaredDistances(cx, cy, ax, ay, bx, by), d);
+	d = _mm_min_ps(getSquaredDistances(dx, dy, ax, ay, bx, by), d);
+	d = _mm_andnot_ps(crossing, d);
+	return _mm_movemask_ps(_mm_cmplt_ps(d, distance_squared));
+}
+#endif
+
+int SegmentKernel::findSegmentWithin(const float* x1, const float* y1, const float* x2, const float* y2, unsigned int nr_segments, float from_x, float from_y, float to_x, float to_y, float distance)
+{
+	const float distance_squared = distance * distance;
+	unsigned int i = 0;
+#ifdef __SSE2__
+	__m128 ax = _mm_set1_ps(from_x);
+	__m128 ay = _mm_set1_ps(from_y);
+	__m128 bx = _mm_set1_ps(to_x);
+	__m128 by = _mm_set1_ps(to_y);
+	__m128 distance_squared_4 = _mm_set1_ps(distance_squared);
+	for (; i + BLOCK_SIZE <= nr_segments; i += BLOCK_SIZE)
+	{
+		int hits = 0;
+		for (unsigned int j = 0; j < BLOCK_SIZE; j += 4)
+		{
+			hits |= findSegmentsWithin(x1 + i + j, y1 + i + j, x2 + i + j, y2 + i + j, ax, ay, bx, by, distance_squared_4) << j;
+		}
+
+		if (hits != 0)
+		{
+			return i + __builtin_ctz(hits);
+		}
+	}
+	
+	// Most cells of a face grid hold fewer faces than a block, so test four of the remaining segments at once too.
+	if (i + 4 <= nr_segments)
+	{
+		int hits = findSegmentsWithin(x1 + i, y1 + i, x2 + i, y2 + i, ax, ay, bx, by, distance_squared_4);
+		if (hits != 0)
+		{
+			return i + __builtin_ctz(hits);
+		}
+		i += 4;
+	}
+#else
+	for (; i + BLOCK_SIZE <= nr_segments; i += BLOCK_SIZE)
+	{
+		float block[BLOCK_SIZE];
+		for (unsigned int j = 0; j < BLOCK_SIZE; ++j)
+		{
+			block[j] = getSquaredDistance(from_x, from_y, to_x, to_y, x1[i + j], y1[i + j], x2[i + j], y2[i + j]);
+		}
+
+		int hits = 0;
+		for (unsigned int j = 0; j < BLOCK_SIZE; ++j)
+		{
+			hits |= (block[j] < distance_squared) << j;
+		}
+
+		if (hits != 0)
+		{
+			return i + __builtin_ctz(hits);
+		}
+	}
+#endif
+
+	for (; i < nr_segments; ++i)
+	{
+		if (getSquaredDistance(from_x, from_y, to_x, to_y, x1[i], y1[i], x2[i], y2[i]) < distance_squared)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+int SegmentKernel::findSegmentNear(const float* x1, const float* y1, const float* z1, const float* x2, const float* y2, const float* z2, unsigned int nr_segments, float x, float y, float z, float distance)
+{
+	const float distance_squared = distance * distance;
+	unsigned int i = 0;
+#ifdef __SSE2__
+	__m128 px = _mm_set1_ps(x);
+	__m128 py = _mm_set1_ps(y);
+	__m128 pz = _mm_set1_ps(z);
+	__m128 distance_squared_4 = _mm_set1_ps(distance_squared);
+	for (; i + BLOCK_SIZE <= nr_segments; i += BLOCK_SIZE)
+	{
+		int hits = 0;
+		for (unsigned int j = 0; j < BLOCK_SIZE; j += 4)
+		{
+			__m128 d = getSquaredDistances(px, py, pz, _mm_loadu_ps(x1 + i + j), _mm_loadu_ps(y1 + i + j), _mm_loadu_ps(z1 + i + j), _mm_loadu_ps(x2 + i + j), _mm_loadu_ps(y2 + i + j), _mm_loadu_ps(z2 + i + j));
+			hits |= _mm_movemask_ps(_mm_cmplt_ps(d, distance_squared_4)) << j;
+		}
+
+		if (hits != 0)
+		{
+			return i + __builtin_ctz(hits);
+		}
+	}
+	
+	if (i + 4 <= nr_segments)
+	{
+		__m128 d = getSquaredDistances(px, py, pz, _mm_loadu_ps(x1 + i), _mm_loadu_ps(y1 + i), _mm_loadu_ps(z1 + i), _mm_loadu_ps(x2 + i), _mm_loadu_ps(y2 + i), _mm_loadu_ps(z2 + i));
+		int hits = _mm_movemask_ps(_mm_cmplt_ps(d, distance_squared_4));
+		if (hits != 0)
+		{
+			return i + __builtin_ctz(hits);
+		}
+		i += 4;
+	}
+#else
+	for (; i + BLOCK_SIZE <= nr_segments; i += BLOCK_SIZE)
+	{
+		float block[BLOCK_SIZE];
+		for (unsigned int j = 0; j < BLOCK_SIZE; ++j)
+		{
+			block[j] = getSquaredDistance(x, y, z, x1[i + j], y1[i + j], z1[i + j], x2[i + j], y2[i + j], z2[i + j]);
+		}
+
+		int hits = 0;
+		for (unsigned int j = 0; j < BLOCK_SIZE; ++j)
+		{
+			hits |= (block[j] < distance_squared) << j;
+		}
+
+		if (hits != 0)
+		{
+			return i + __builtin_ctz(hits);
+		}
+	}
+#endif
+
+	for (; i < nr_segments; ++i)
+	{
+		if (getSquaredDistance(x, y, z, x1[i], y1[i], z1[i], x2[i], y2[i], z2[i]) < distance_squared)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
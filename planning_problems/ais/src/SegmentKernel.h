@@ -0,0 +1,86 @@
+#ifndef TURTLEBOT_PLANNER_ONTOLOGY_SEGMENT_KERNEL_H
+#define TURTLEBOT_PLANNER_ONTOLOGY_SEGMENT_KERNEL_H
+
+/**
+ * Batched distance tests of one query against many line segments. The segments are stored as separate
+ * arrays per coordinate (x1[], y1[], ...) and are processed in fixed size blocks without branches, which
+ * are tested with SSE where it is available and with the scalar functions below otherwise. We only check
+ * for a hit after every block, so we stop early without giving up the vectorisation.
+ */
+class SegmentKernel
+{
+public:
+	static const unsigned int BLOCK_SIZE = 8;
+
+	/**
+	 * Find a segment whose distance to the segment from (@ref{from_x}, @ref{from_y}) to (@ref{to_x}, @ref{to_y})
+	 * is less than @ref{distance}, all in the XY plane.
+	 * @return The index of such a segment, or -1 if there is none.
+	 */
+	static int findSegmentWithin(const float* x1, const float* y1, const float* x2, const float* y2, unsigned int nr_segments, float from_x, float from_y, float to_x, float to_y, float distance);
+
+	/**
+	 * Find a segment whose distance to the point (@ref{x}, @ref{y}, @ref{z}) is less than @ref{distance}.
+	 * @return The index of such a segment, or -1 if there is none.
+	 */
+	static int findSegmentNear(const float* x1, const float* y1, const float* z1, const float* x2, const float* y2, const float* z2, unsigned int nr_segments, float x, float y, float z, float distance);
+
+	/**
+	 * The squared distance between the segments (@ref{ax}, @ref{ay}) - (@ref{bx}, @ref{by}) and (@ref{cx}, @ref{cy}) - (@ref{dx}, @ref{dy}).
+	 */
+	static inline float getSquaredDistance(float ax, float ay, float bx, float by, float cx, float cy, float dx, float dy)
+	{
+		// Segments that cross each other have distance 0, otherwise the closest pair of points includes an end point.
+		float o1 = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+		float o2 = (bx - ax) * (dy - ay) - (by - ay) * (dx - ax);
+		float o3 = (dx - cx) * (ay - cy) - (dy - cy) * (ax - cx);
+		float o4 = (dx - cx) * (by - cy) - (dy - cy) * (bx - cx);
+		bool not_collinear = (o1 != 0.0f) | (o2 != 0.0f);
+		bool crossing = (o1 * o2 <= 0.0f) & (o3 * o4 <= 0.0f) & not_collinear;
+
+		float d = getSquaredDistance(ax, ay, cx, cy, dx, dy);
+		float d2 = getSquaredDistance(bx, by, cx, cy, dx, dy);
+		d = d2 < d ? d2 : d;
+		d2 = getSquaredDistance(cx, cy, ax, ay, bx, by);
+		d = d2 < d ? d2 : d;
+		d2 = getSquaredDistance(dx, dy, ax, ay, bx, by);
+		d = d2 < d ? d2 : d;
+		return crossing ? 0.0f : d;
+	}
+
+	/**
+	 * The squared distance between the point (@ref{px}, @ref{py}) and the segment (@ref{ux}, @ref{uy}) - (@ref{vx}, @ref{vy}).
+	 */
+	static inline float getSquaredDistance(float px, float py, float ux, float uy, float vx, float vy)
+	{
+		float dx = vx - ux;
+		float dy = vy - uy;
+		float length_squared = dx * dx + dy * dy;
+		length_squared = length_squared > 1e-12f ? length_squared : 1e-12f;
+		float t = ((px - ux) * dx + (py - uy) * dy) / length_squared;
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		float ex = ux + t * dx - px;
+		float ey = uy + t * dy - py;
+		return ex * ex + ey * ey;
+	}
+
+	/**
+	 * The squared distance between the point (@ref{px}, @ref{py}, @ref{pz}) and the segment (@ref{ux}, @ref{uy}, @ref{uz}) - (@ref{vx}, @ref{vy}, @ref{vz}).
+	 */
+	static inline float getSquaredDistance(float px, float py, float pz, float ux, float uy, float uz, float vx, float vy, float vz)
+	{
+		float dx = vx - ux;
+		float dy = vy - uy;
+		float dz = vz - uz;
+		float length_squared = dx * dx + dy * dy + dz * dz;
+		length_squared = length_squared > 1e-12f ? length_squared : 1e-12f;
+		float t = ((px - ux) * dx + (py - uy) * dy + (pz - uz) * dz) / length_squared;
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		float ex = ux + t * dx - px;
+		float ey = uy + t * dy - py;
+		float ez = uz + t * dz - pz;
+		return ex * ex + ey * ey + ez * ez;
+	}
+};
+
+#endif
@@ -73,6 +73,12 @@ Shape::Shape(const Vector3D& location, const RotationMatrix& rotation)
 	
 }
 
+Shape::Shape(const std::string& ontology_name, const Vector3D& location, const RotationMatrix& rotation, bool is_target)
+	: ontology_name_(ontology_name), location_(location), rotation_(rotation), is_target_(is_target)
+{
+	
+}
+
 Shape::Shape(const Shape& shape)
 	: ontology_name_(shape.ontology_name_), location_(shape.location_), rotation_(shape.rotation_), is_target_(shape.is_target_),  interesting_points_(shape.interesting_points_)
 {
@@ -27,6 +27,11 @@ public:
 	 */
 	Shape(const Vector3D& location, const RotationMatrix& rotation);
 	
+	/**
+	 * Create a shape that was not loaded from the ontology, its faces are added with @ref{addFace}.
+	 */
+	Shape(const std::string& ontology_name, const Vector3D& location, const RotationMatrix& rotation, bool is_target);
+	
 	/**
 	 * Copy constructor.
 	 */
@@ -0,0 +1,368 @@
+#include <turtlebot_planner/Ontology/ShapeQueryCache.h>
+
+#include <algorithm>
+#include <string.h>
+
+#include <turtlebot_planner/Ontology/Shape.h>
+#include <turtlebot_planner/Ontology/Face.h>
+#include <turtlebot_planner/Ontology/SegmentKernel.h>
+
+ShapeQueryCache::ShapeQueryCache(unsigned int max_nr_segments)
+	: max_nr_segments_per_shard_(std::max(1u, max_nr_segments / NR_SHARDS))
+{
+	pthread_mutex_init(&shapes_mutex_, NULL);
+	for (unsigned int i = 0; i < NR_SHARDS; ++i)
+	{
+		shards_[i].nr_tests_ = 0;
+		pthread_mutex_init(&shards_[i].mutex_, NULL);
+	}
+}
+
+ShapeQueryCache::~ShapeQueryCache()
+{
+	pthread_mutex_destroy(&shapes_mutex_);
+	for (unsigned int i = 0; i < NR_SHARDS; ++i)
+	{
+		pthread_mutex_destroy(&shards_[i].mutex_);
+	}
+}
+
+unsigned int ShapeQueryCache::addShape(const Shape& shape)
+{
+	std::vector<float> signature;
+	for (std::vector<const Face*>::const_iterator ci = shape.getFaces().begin(); ci != shape.getFaces().end(); ++ci)
+	{
+		const Face* face = *ci;
+		signature.push_back(face->getP1().x_);
+		signature.push_back(face->getP1().y_);
+		signature.push_back(face->getP2().x_);
+		signature.push_back(face->getP2().y_);
+	}
+	
+	pthread_mutex_lock(&shapes_mutex_);
+	std::map<std::vector<float>, unsigned int>::const_iterator ci = shape_ids_.find(signature);
+	if (ci != shape_ids_.end())
+	{
+		unsigned int shape_id = (*ci).second;
+		is_used_[shape_id] = true;
+		pthread_mutex_unlock(&shapes_mutex_);
+		return shape_id;
+	}
+	
+	ShapeGeometry geometry;
+	geometry.min_x_ = geometry.min_y_ = 0;
+	geometry.max_x_ = geometry.max_y_ = 0;
+	for (unsigned int i = 0; i < signature.size(); i += 4)
+	{
+		geometry.x1_.push_back(signature[i]);
+		geometry.y1_.push_back(signature[i + 1]);
+		geometry.x2_.push_back(signature[i + 2]);
+		geometry.y2_.push_back(signature[i + 3]);
+		
+		float min_x = std::min(signature[i], signature[i + 2]);
+		float min_y = std::min(signature[i + 1], signature[i + 3]);
+		float max_x = std::max(signature[i], signature[i + 2]);
+		float max_y = std::max(signature[i + 1], signature[i + 3]);
+		if (i == 0)
+		{
+			geometry.min_x_ = min_x;
+			geometry.min_y_ = min_y;
+			geometry.max_x_ = max_x;
+			geometry.max_y_ = max_y;
+		}
+		else
+		{
+			geometry.min_x_ = std::min(geometry.min_x_, min_x);
+			geometry.min_y_ = std::min(geometry.min_y_, min_y);
+			geometry.max_x_ = std::max(geometry.max_x_, max_x);
+			geometry.max_y_ = std::max(geometry.max_y_, max_y);
+		}
+	}
+	
+	// Reuse the id of a removed shape, so the shape sets do not grow with every reload.
+	unsigned int shape_id;
+	if (!free_ids_.empty())
+	{
+		shape_id = free_ids_.back();
+		free_ids_.pop_back();
+		shapes_[shape_id] = geometry;
+		is_used_[shape_id] = true;
+	}
+	else
+	{
+		shape_id = shapes_.size();
+		shapes_.push_back(geometry);
+		is_used_.push_back(true);
+	}
+	shape_ids_[signature] = shape_id;
+	pthread_mutex_unlock(&shapes_mutex_);
+	return shape_id;
+}
+
+void ShapeQueryCache::addToShapeSet(ShapeSet& shape_set, unsigned int shape_id)
+{
+	if (shape_set.size() <= shape_id / 64)
+	{
+		shape_set.resize(shape_id / 64 + 1, 0);
+	}
+	shape_set[shape_id / 64] |= 1ULL << (shape_id % 64);
+}
+
+ShapeQueryCache::RESULT ShapeQueryCache::getResult(const ShapeSet& shape_set, const Vector2D& from, const Vector2D& to, float distance) const
+{
+	Segment segment(from, to, distance);
+	Shard& shard = getShard(segment);
+	pthread_mutex_lock(&shard.mutex_);
+	std::map<Segment, Results>::const_iterator ci = shard.results_.find(segment);
+	if (ci == shard.results_.end())
+	{
+		pthread_mutex_unlock(&shard.mutex_);
+		return UNKNOWN;
+	}
+	
+	const Results& results = (*ci).second;
+	bool is_tested = true;
+	for (unsigned int i = 0; i < shape_set.size(); ++i)
+	{
+		unsigned long long tested_shapes = i < results.tested_shapes_.size() ? results.tested_shapes_[i] : 0;
+		unsigned long long near_shapes = i < results.near_shapes_.size() ? results.near_shapes_[i] : 0;
+		if ((shape_set[i] & near_shapes) != 0)
+		{
+			pthread_mutex_unlock(&shard.mutex_);
+			return NEAR;
+		}
+		is_tested = is_tested && (shape_set[i] & ~tested_shapes) == 0;
+	}
+	pthread_mutex_unlock(&shard.mutex_);
+	return is_tested ? NOT_NEAR : UNKNOWN;
+}
+
+bool ShapeQueryCache::isNearSegment(const ShapeSet& shape_set, const std::vector<unsigned int>& candidate_ids, const Vector2D& from, const Vector2D& to, float distance)
+{
+	Segment segment(from, to, distance);
+	Shard& shard = getShard(segment);
+	
+	// Another thread may have stored the results of some shapes since getResult, so check again whether one of them is
+	// near the segment. Only then are the tested candidates known to be further away, and only the others are tested.
+	std::vector<unsigned int> untested_ids;
+	pthread_mutex_lock(&shard.mutex_);
+	std::map<Segment, Results>::const_iterator ci = shard.results_.find(segment);
+	if (ci != shard.results_.end())
+	{
+		const ShapeSet& known_near_shapes = (*ci).second.near_shapes_;
+		for (unsigned int i = 0; i < shape_set.size() && i < known_near_shapes.size(); ++i)
+		{
+			if ((shape_set[i] & known_near_shapes[i]) != 0)
+			{
+				pthread_mutex_unlock(&shard.mutex_);
+				return true;
+			}
+		}
+	}
+	for (std::vector<unsigned int>::const_iterator candidate_ci = candidate_ids.begin(); candidate_ci != candidate_ids.end(); ++candidate_ci)
+	{
+		unsigned int shape_id = *candidate_ci;
+		if (ci == shard.results_.end() || shape_id / 64 >= (*ci).second.tested_shapes_.size() ||
+		    ((*ci).second.tested_shapes_[shape_id / 64] & (1ULL << (shape_id % 64))) == 0)
+		{
+			untested_ids.push_back(shape_id);
+		}
+	}
+	pthread_mutex_unlock(&shard.mutex_);
+	
+	// Two threads may test the same shape, but they will store the same result.
+	ShapeSet near_shapes;
+	for (std::vector<unsigned int>::const_iterator ci = untested_ids.begin(); ci != untested_ids.end(); ++ci)
+	{
+		if (isNearSegment(*ci, segment))
+		{
+			addToShapeSet(near_shapes, *ci);
+		}
+	}
+	
+	// The shapes that are not candidates are not near the segment either, so all the shapes are tested now.
+	pthread_mutex_lock(&shard.mutex_);
+	if (shard.results_.size() >= max_nr_segments_per_shard_ && shard.results_.find(segment) == shard.results_.end())
+	{
+		shard.results_.clear();
+	}
+	Results& results = shard.results_[segment];
+	if (results.tested_shapes_.size() < shape_set.size())
+	{
+		results.tested_shapes_.resize(shape_set.size(), 0);
+	}
+	for (unsigned int i = 0; i < shape_set.size(); ++i)
+	{
+		results.tested_shapes_[i] |= shape_set[i];
+	}
+	if (results.near_shapes_.size() < near_shapes.size())
+	{
+		results.near_shapes_.resize(near_shapes.size(), 0);
+	}
+	for (unsigned int i = 0; i < near_shapes.size(); ++i)
+	{
+		results.near_shapes_[i] |= near_shapes[i];
+	}
+	shard.nr_tests_ += untested_ids.size();
+	pthread_mutex_unlock(&shard.mutex_);
+	return !near_shapes.empty();
+}
+
+void ShapeQueryCache::clear()
+{
+	pthread_mutex_lock(&shapes_mutex_);
+	shape_ids_.clear();
+	shapes_.clear();
+	is_used_.clear();
+	free_ids_.clear();
+	pthread_mutex_unlock(&shapes_mutex_);
+	
+	for (unsigned int i = 0; i < NR_SHARDS; ++i)
+	{
+		pthread_mutex_lock(&shards_[i].mutex_);
+		shards_[i].results_.clear();
+		shards_[i].nr_tests_ = 0;
+		pthread_mutex_unlock(&shards_[i].mutex_);
+	}
+}
+
+void ShapeQueryCache::markShapesUnused()
+{
+	pthread_mutex_lock(&shapes_mutex_);
+	std::fill(is_used_.begin(), is_used_.end(), false);
+	pthread_mutex_unlock(&shapes_mutex_);
+}
+
+unsigned int ShapeQueryCache::removeUnusedShapes()
+{
+	pthread_mutex_lock(&shapes_mutex_);
+	unsigned int nr_removed_shapes = 0;
+	ShapeSet used_shapes;
+	for (std::map<std::vector<float>, unsigned int>::iterator i = shape_ids_.begin(); i != shape_ids_.end();)
+	{
+		unsigned int shape_id = (*i).second;
+		if (is_used_[shape_id])
+		{
+			addToShapeSet(used_shapes, shape_id);
+			++i;
+			continue;
+		}
+		
+		// The results of the id are cleared below, before it is given to another shape.
+		shapes_[shape_id] = ShapeGeometry();
+		free_ids_.push_back(shape_id);
+		shape_ids_.erase(i++);
+		++nr_removed_shapes;
+	}
+	
+	// Forget the results of the removed shapes, and the segments without results of the remaining shapes.
+	for (unsigned int shard_nr = 0; shard_nr < NR_SHARDS; ++shard_nr)
+	{
+		Shard& shard = shards_[shard_nr];
+		pthread_mutex_lock(&shard.mutex_);
+		for (std::map<Segment, Results>::iterator i = shard.results_.begin(); i != shard.results_.end();)
+		{
+			Results& results = (*i).second;
+			bool is_empty = true;
+			for (unsigned int word = 0; word < results.tested_shapes_.size(); ++word)
+			{
+				unsigned long long used = word < used_shapes.size() ? used_shapes[word] : 0;
+				results.tested_shapes_[word] &= used;
+				if (word < results.near_shapes_.size())
+				{
+					results.near_shapes_[word] &= used;
+				}
+				is_empty = is_empty && results.tested_shapes_[word] == 0;
+			}
+			
+			if (is_empty)
+			{
+				shard.results_.erase(i++);
+			}
+			else
+			{
+				++i;
+			}
+		}
+		pthread_mutex_unlock(&shard.mutex_);
+	}
+	pthread_mutex_unlock(&shapes_mutex_);
+	return nr_removed_shapes;
+}
+
+unsigned int ShapeQueryCache::getNumberOfTests() const
+{
+	unsigned int nr_tests = 0;
+	for (unsigned int i = 0; i < NR_SHARDS; ++i)
+	{
+		pthread_mutex_lock(&shards_[i].mutex_);
+		nr_tests += shards_[i].nr_tests_;
+		pthread_mutex_unlock(&shards_[i].mutex_);
+	}
+	return nr_tests;
+}
+
+unsigned int ShapeQueryCache::getNumberOfCachedResults() const
+{
+	unsigned int nr_results = 0;
+	for (unsigned int i = 0; i < NR_SHARDS; ++i)
+	{
+		pthread_mutex_lock(&shards_[i].mutex_);
+		nr_results += shards_[i].results_.size();
+		pthread_mutex_unlock(&shards_[i].mutex_);
+	}
+	return nr_results;
+}
+
+ShapeQueryCache::Shard& ShapeQueryCache::getShard(const Segment& segment) const
+{
+	float coordinates[] = { segment.from_x_, segment.from_y_, segment.to_x_, segment.to_y_, segment.distance_ };
+	unsigned int hash = 2166136261u;
+	for (unsigned int i = 0; i < 5; ++i)
+	{
+		unsigned int bits;
+		memcpy(&bits, &coordinates[i], sizeof(bits));
+		hash = (hash ^ bits) * 16777619u;
+	}
+	return shards_[(hash ^ (hash >> 16)) % NR_SHARDS];
+}
+
+bool ShapeQueryCache::isNearSegment(unsigned int shape_id, const Segment& segment) const
+{
+	const ShapeGeometry& geometry = shapes_[shape_id];
+	if (geometry.x1_.empty() ||
+	    std::max(segment.from_x_, segment.to_x_) + segment.distance_ < geometry.min_x_ || std::min(segment.from_x_, segment.to_x_) - segment.distance_ > geometry.max_x_ ||
+	    std::max(segment.from_y_, segment.to_y_) + segment.distance_ < geometry.min_y_ || std::min(segment.from_y_, segment.to_y_) - segment.distance_ > geometry.max_y_)
+	{
+		return false;
+	}
+	return SegmentKernel::findSegmentWithin(&geometry.x1_[0], &geometry.y1_[0], &geometry.x2_[0], &geometry.y2_[0], geometry.x1_.size(), segment.from_x_, segment.from_y_, segment.to_x_, segment.to_y_, segment.distance_) != -1;
+}
+
+ShapeQueryCache::Segment::Segment(const Vector2D& from, const Vector2D& to, float distance)
+	: distance_(distance)
+{
+	if (from.x_ < to.x_ || (from.x_ == to.x_ && from.y_ < to.y_))
+	{
+		from_x_ = from.x_;
+		from_y_ = from.y_;
+		to_x_ = to.x_;
+		to_y_ = to.y_;
+	}
+	else
+	{
+		from_x_ = to.x_;
+		from_y_ = to.y_;
+		to_x_ = from.x_;
+		to_y_ = from.y_;
+	}
+}
+
+bool ShapeQueryCache::Segment::operator<(const Segment& other) const
+{
+	if (from_x_ != other.from_x_) return from_x_ < other.from_x_;
+	if (from_y_ != other.from_y_) return from_y_ < other.from_y_;
+	if (to_x_ != other.to_x_) return to_x_ < other.to_x_;
+	if (to_y_ != other.to_y_) return to_y_ < other.to_y_;
+	return distance_ < other.distance_;
+}
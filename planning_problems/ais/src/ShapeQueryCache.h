@@ -0,0 +1,142 @@
+#ifndef TURTLEBOT_PLANNER_ONTOLOGY_SHAPE_QUERY_CACHE_H
+#define TURTLEBOT_PLANNER_ONTOLOGY_SHAPE_QUERY_CACHE_H
+
+#include <vector>
+#include <map>
+#include <pthread.h>
+
+#include "Vector2D.h"
+
+class Shape;
+
+/**
+ * Most scenes contain the same objects, but every scene holds its own copy of their shapes. This cache
+ * identifies shapes by their geometry, so the copies in all the scenes share the same id, and remembers
+ * for every line segment which shapes have been tested against it and which of those are near it. A query
+ * of a scene whose shapes have all been tested in other scenes is then answered with a single look up;
+ * otherwise only the shapes that have not been tested yet are.
+ *
+ * The line segments are spread over shards, every shard has its own lock and holds at most a fixed number
+ * of line segments; a full shard forgets all of them. Shapes must be added before the cache is queried,
+ * queries can be made from multiple threads.
+ */
+class ShapeQueryCache
+{
+public:
+	/**
+	 * A set of shape ids, one bit per id.
+	 */
+	typedef std::vector<unsigned long long> ShapeSet;
+	
+	enum RESULT { NOT_NEAR, NEAR, UNKNOWN };
+	
+	/**
+	 * @param max_nr_segments The maximum number of line segments whose results are remembered.
+	 */
+	ShapeQueryCache(unsigned int max_nr_segments = 1 << 17);
+	~ShapeQueryCache();
+	
+	/**
+	 * Register a shape.
+	 * @return The id of the shape, shapes with identical faces get the same id.
+	 */
+	unsigned int addShape(const Shape& shape);
+	
+	/**
+	 * Add the shape with id @ref{shape_id} to @ref{shape_set}.
+	 */
+	static void addToShapeSet(ShapeSet& shape_set, unsigned int shape_id);
+	
+	/**
+	 * Check if any shape of @ref{shape_set} is closer than @ref{distance} to the line segment from @ref{from} to
+	 * @ref{to}, in the XY plane, using the results of earlier queries only.
+	 * @return UNKNOWN if neither a shape that is near the segment nor all the shapes have been tested before.
+	 */
+	RESULT getResult(const ShapeSet& shape_set, const Vector2D& from, const Vector2D& to, float distance) const;
+	
+	/**
+	 * Check if any shape of @ref{shape_set} is closer than @ref{distance} to the line segment from @ref{from} to
+	 * @ref{to}, in the XY plane. Only the candidates that have not been tested before are tested; the other shapes
+	 * of @ref{shape_set} are remembered to be further away.
+	 * @param candidate_ids The ids of the shapes of @ref{shape_set} that might be near the segment, e.g. the shapes
+	 * with a face in the cells of a @ref{FaceGrid} near it.
+	 */
+	bool isNearSegment(const ShapeSet& shape_set, const std::vector<unsigned int>& candidate_ids, const Vector2D& from, const Vector2D& to, float distance);
+	
+	/**
+	 * Forget all the shapes and the results of the queries.
+	 */
+	void clear();
+	
+	/**
+	 * Mark all the shapes as unused, such that the scenes can be reloaded without forgetting the results of the
+	 * shapes that did not change. Every shape that is added afterwards is marked as used again.
+	 */
+	void markShapesUnused();
+	
+	/**
+	 * Forget the shapes that have not been added since @ref{markShapesUnused} and the results of their queries.
+	 * The ids of the remaining shapes do not change, the ids of the removed shapes are given to the shapes that are
+	 * added later. The scenes that contain the removed shapes must therefore be deleted first.
+	 * @return The number of shapes that were removed.
+	 */
+	unsigned int removeUnusedShapes();
+	
+	unsigned int getNumberOfTests() const;
+	unsigned int getNumberOfCachedResults() const;
+private:
+	struct ShapeGeometry
+	{
+		float min_x_, min_y_, max_x_, max_y_;   // The bounding box of the projected faces.
+		std::vector<float> x1_, y1_, x2_, y2_; // The end points of the faces, one array per coordinate.
+	};
+	
+	/**
+	 * A line segment and a distance, the end points are ordered such that both directions are the same segment.
+	 */
+	struct Segment
+	{
+		Segment(const Vector2D& from, const Vector2D& to, float distance);
+	
+		float from_x_, from_y_, to_x_, to_y_;
+		float distance_;
+	
+		bool operator<(const Segment& other) const;
+	};
+	
+	struct Results
+	{
+		ShapeSet tested_shapes_; // The shapes that have been tested against the segment.
+		ShapeSet near_shapes_;   // The tested shapes that are near the segment.
+	};
+	
+	struct Shard
+	{
+		std::map<Segment, Results> results_;
+		unsigned int nr_tests_;         // The number of shapes that had to be tested.
+		pthread_mutex_t mutex_;         // Guards results_ and nr_tests_.
+	};
+	
+	static const unsigned int NR_SHARDS = 16;
+	
+	/**
+	 * Get the shard that stores the results of @ref{segment}.
+	 */
+	Shard& getShard(const Segment& segment) const;
+	
+	/**
+	 * Check if the shape with id @ref{shape_id} is closer than the distance of @ref{segment} to it.
+	 */
+	bool isNearSegment(unsigned int shape_id, const Segment& segment) const;
+	
+	std::map<std::vector<float>, unsigned int> shape_ids_; // The coordinates of the faces of a shape, mapped to its id.
+	std::vector<ShapeGeometry> shapes_;                    // All the shapes, indexed by their id.
+	std::vector<bool> is_used_;                            // For every shape, whether a scene added it since markShapesUnused.
+	std::vector<unsigned int> free_ids_;                   // The ids of the removed shapes, which have no results.
+	pthread_mutex_t shapes_mutex_;                         // Guards the shapes, which are added while the scenes are loaded.
+	
+	unsigned int max_nr_segments_per_shard_;
+	mutable Shard shards_[NR_SHARDS];
+};
+
+#endif
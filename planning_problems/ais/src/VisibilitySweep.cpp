@@ -0,0 +1,156 @@
+#include <turtlebot_planner/Ontology/VisibilitySweep.h>
+
+#include <algorithm>
+#include <math.h>
+
+#include <turtlebot_planner/Ontology/Face.h>
+#include <turtlebot_planner/Ontology/FaceGrid.h>
+
+// The intervals of the faces are widened by this angle, such that rounding errors cannot leave out a face that
+// blocks a line of sight. A face that is included but does not block it only costs a test.
+static const float ANGLE_MARGIN = 0.001f;
+
+// The faces that are closer than this to the location are tested for every query.
+static const float MIN_FACE_DISTANCE = 0.001f;
+
+VisibilitySweep::VisibilitySweep(const Vector2D& location, const std::vector<const Face*>& faces)
+	: location_(location), faces_(faces), nr_tests_(0)
+{
+	for (unsigned int face_id = 0; face_id < faces_.size(); ++face_id)
+	{
+		addFace(face_id);
+	}
+}
+
+unsigned int VisibilitySweep::addQuery(const Vector2D& point, const Face* ignored_face)
+{
+	Event event;
+	event.angle_ = atan2(point.y_ - location_.y_, point.x_ - location_.x_);
+	event.type_ = QUERY;
+	event.id_ = query_points_.size();
+	events_.push_back(event);
+	
+	query_points_.push_back(point);
+	ignored_faces_.push_back(ignored_face);
+	return event.id_;
+}
+
+void VisibilitySweep::sweep()
+{
+	std::sort(events_.begin(), events_.end());
+	is_visible_.assign(query_points_.size(), true);
+	nr_tests_ = 0;
+	
+	// The faces whose interval contains the current angle, and for every face its index in active_faces.
+	std::vector<unsigned int> active_faces;
+	std::vector<int> active_index(faces_.size(), -1);
+	for (std::vector<Event>::const_iterator ci = events_.begin(); ci != events_.end(); ++ci)
+	{
+		const Event& event = *ci;
+		if (event.type_ == BEGIN)
+		{
+			active_index[event.id_] = active_faces.size();
+			active_faces.push_back(event.id_);
+		}
+		else if (event.type_ == END)
+		{
+			// Move the last active face into the place of the face that ends.
+			unsigned int index = active_index[event.id_];
+			active_faces[index] = active_faces.back();
+			active_index[active_faces[index]] = index;
+			active_faces.pop_back();
+			active_index[event.id_] = -1;
+		}
+		else
+		{
+			const Vector2D& point = query_points_[event.id_];
+			const Face* ignored_face = ignored_faces_[event.id_];
+			bool is_visible = true;
+			for (std::vector<unsigned int>::const_iterator ci = active_faces.begin(); is_visible && ci != active_faces.end(); ++ci)
+			{
+				is_visible = !isBlocking(*faces_[*ci], point, ignored_face);
+			}
+			for (std::vector<unsigned int>::const_iterator ci = always_active_faces_.begin(); is_visible && ci != always_active_faces_.end(); ++ci)
+			{
+				is_visible = !isBlocking(*faces_[*ci], point, ignored_face);
+			}
+			is_visible_[event.id_] = is_visible;
+		}
+	}
+}
+
+void VisibilitySweep::addFace(unsigned int face_id)
+{
+	const Face& face = *faces_[face_id];
+	Vector2D p1(face.getP1().x_, face.getP1().y_);
+	Vector2D p2(face.getP2().x_, face.getP2().y_);
+	if (FaceGrid::getDistance(location_, p1, p2) < MIN_FACE_DISTANCE)
+	{
+		always_active_faces_.push_back(face_id);
+		return;
+	}
+	
+	// The face covers the shorter arc between the angles of its end points.
+	float p1_angle = atan2(p1.y_ - location_.y_, p1.x_ - location_.x_);
+	float p2_angle = atan2(p2.y_ - location_.y_, p2.x_ - location_.x_);
+	float arc = p2_angle - p1_angle;
+	if (arc > M_PI)
+	{
+		arc -= 2 * M_PI;
+	}
+	else if (arc < -M_PI)
+	{
+		arc += 2 * M_PI;
+	}
+	float begin_angle = (arc >= 0 ? p1_angle : p2_angle) - ANGLE_MARGIN;
+	float end_angle = begin_angle + fabs(arc) + 2 * ANGLE_MARGIN;
+	
+	// Split the intervals that wrap around, the angles of the queries are in [-pi, pi].
+	if (begin_angle < -M_PI)
+	{
+		addInterval(face_id, begin_angle + 2 * M_PI, M_PI);
+		addInterval(face_id, -M_PI, end_angle);
+	}
+	else if (end_angle > M_PI)
+	{
+		addInterval(face_id, begin_angle, M_PI);
+		addInterval(face_id, -M_PI, end_angle - 2 * M_PI);
+	}
+	else
+	{
+		addInterval(face_id, begin_angle, end_angle);
+	}
+}
+
+void VisibilitySweep::addInterval(unsigned int face_id, float begin_angle, float end_angle)
+{
+	Event event;
+	event.id_ = face_id;
+	event.angle_ = begin_angle;
+	event.type_ = BEGIN;
+	events_.push_back(event);
+	event.angle_ = end_angle;
+	event.type_ = END;
+	events_.push_back(event);
+}
+
+bool VisibilitySweep::isBlocking(const Face& face, const Vector2D& point, const Face* ignored_face)
+{
+	if (&face == ignored_face)
+	{
+		return false;
+	}
+	++nr_tests_;
+	
+	Vector2D face_p1(face.getP1().x_, face.getP1().y_);
+	Vector2D face_p2(face.getP2().x_, face.getP2().y_);
+	Vector2D intersection;
+	return Vector2D::getIntersectionSegments(location_, point, face_p1, face_p2, intersection) &&
+	       intersection.getDistance(point) > 0.01f;
+}
+
+bool VisibilitySweep::Event::operator<(const Event& other) const
+{
+	if (angle_ != other.angle_) return angle_ < other.angle_;
+	return type_ < other.type_;
+}
@@ -0,0 +1,89 @@
+#ifndef TURTLEBOT_PLANNER_ONTOLOGY_VISIBILITY_SWEEP_H
+#define TURTLEBOT_PLANNER_ONTOLOGY_VISIBILITY_SWEEP_H
+
+#include <vector>
+
+#include "Vector2D.h"
+
+class Face;
+
+/**
+ * Answers all the line of sight queries from a single location at once with a rotational sweep. Every face
+ * covers an interval of angles as seen from the location; the sweep visits the begin and end of these intervals
+ * and the queries in order of their angle, and keeps the faces whose interval contains the current angle. A line
+ * of sight can only be blocked by those faces, so every query is tested against a few faces instead of all of them.
+ *
+ * The faces are not ordered by their distance (as in a visibility polygon), because the faces of overlapping
+ * shapes cross each other; the result is the same as testing every face.
+ */
+class VisibilitySweep
+{
+public:
+	/**
+	 * @param location The location from where all the points are observed.
+	 * @param faces The faces that can block a line of sight, these must exist as long as this object.
+	 */
+	VisibilitySweep(const Vector2D& location, const std::vector<const Face*>& faces);
+
+	/**
+	 * Add a query, whether @ref{point} is visible from the location. A face blocks the line of sight unless the
+	 * intersection is within 0.01 of @ref{point} (see Scene::canSee).
+	 * @param point The point to observe.
+	 * @param ignored_face A face that never blocks the line of sight, e.g. the face that @ref{point} is part of.
+	 * @return The id of the query.
+	 */
+	unsigned int addQuery(const Vector2D& point, const Face* ignored_face = NULL);
+
+	/**
+	 * Answer all the queries that have been added.
+	 */
+	void sweep();
+
+	/**
+	 * @return True if the point of the query with id @ref{query_id} is visible, only valid after @ref{sweep}.
+	 */
+	bool isVisible(unsigned int query_id) const { return is_visible_[query_id]; }
+
+	/**
+	 * @return The number of line of sight tests against faces that the last @ref{sweep} performed.
+	 */
+	unsigned int getNumberOfTests() const { return nr_tests_; }
+private:
+	/**
+	 * Add the interval of angles that the face with id @ref{face_id} covers as events, or mark the face as always
+	 * active if the location is (almost) on it.
+	 */
+	void addFace(unsigned int face_id);
+
+	/**
+	 * Add the events of the interval [@ref{begin_angle}, @ref{end_angle}] of the face with id @ref{face_id}.
+	 */
+	void addInterval(unsigned int face_id, float begin_angle, float end_angle);
+
+	/**
+	 * Check if the line of sight from the location to @ref{point} is blocked by @ref{face}.
+	 */
+	bool isBlocking(const Face& face, const Vector2D& point, const Face* ignored_face);
+
+	enum EVENT_TYPE { BEGIN = 0, QUERY = 1, END = 2 };
+
+	struct Event
+	{
+		float angle_;
+		EVENT_TYPE type_;
+		unsigned int id_; // The index of the face or the query.
+
+		bool operator<(const Event& other) const;
+	};
+
+	Vector2D location_;
+	std::vector<const Face*> faces_;
+	std::vector<unsigned int> always_active_faces_; // Faces through the location, these cover every angle.
+	std::vector<Event> events_;
+	std::vector<Vector2D> query_points_;
+	std::vector<const Face*> ignored_faces_;
+	std::vector<bool> is_visible_;
+	unsigned int nr_tests_;
+};
+
+#endif
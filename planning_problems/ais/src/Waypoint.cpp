@@ -6,53 +6,57 @@
 
 #include <ontology_db/ontol_access.h>
 
+#include "RosOntologyWriter.h"
+
 #define FLYING_TURTLEBOT_PLANNING_USE_ONTOLOGY
 
 unsigned int Waypoint::waypoint_id_ = 0;
-ros::ServiceClient Waypoint::create_instances_client_;
 OntolAccess* Waypoint::oa_ = NULL;
+OntologyWriter* Waypoint::ontology_writer_ = NULL;
 
 void Waypoint::initWaypoints(ros::NodeHandle& ros_node, OntolAccess& oa)
 {
 	oa_ = &oa;
-	create_instances_client_ = ros_node.serviceClient<ontology_db::CreateInstanceOfClass>("osl_ontology/create_instance_of_class");
+	if (ontology_writer_ == NULL)
+	{
+		ontology_writer_ = new RosOntologyWriter(ros_node, oa);
+	}
+}
+
+void Waypoint::setOntologyWriter(OntologyWriter& ontology_writer)
+{
+	ontology_writer_ = &ontology_writer;
 }
 
 #ifdef FLYING_TURTLEBOT_PLANNING_USE_ONTOLOGY
 Waypoint& Waypoint::generateWaypoint(float x, float y, float theta)
 {
-	ontology_db::CreateInstanceOfClass create_instance;
-	create_instance.request.class_name = "plan:'Pose2D'";
-	if (!create_instances_client_.call(create_instance))
+	// Only the name of the pose is needed now (it is the predicate), everything else is written when the writer is flushed.
+	std::string pose2d_instance_name = ontology_writer_->createInstance("plan:'Pose2D'");
+	if (pose2d_instance_name.empty())
 	{
 		std::cout << "Failed to add a pose to the ontology!" << std::endl;
 	}
-	std::string pose2d_instance_name = create_instance.response.instance_name;
 
-	oa_->setFloatProperty(pose2d_instance_name, "knowrob:'xCoord'", x);
-	oa_->setFloatProperty(pose2d_instance_name, "knowrob:'yCoord'", y);
+	ontology_writer_->setFloatProperty(pose2d_instance_name, "knowrob:'xCoord'", x);
+	ontology_writer_->setFloatProperty(pose2d_instance_name, "knowrob:'yCoord'", y);
 	
 	// Create the rotation matrix.
-	create_instance.request.class_name = "knowrob:'RotationMatrix2D'";
-	if (!create_instances_client_.call(create_instance))
-	{
-		std::cout << "Failed to add a 2D rotation matrix to the ontology!" << std::endl;
-	}
-	std::string rotation_matrix_instance_name = create_instance.response.instance_name;
-	oa_->setStringProperty(pose2d_instance_name, "knowrob:'orientation'", rotation_matrix_instance_name);
+	std::string rotation_matrix_instance_name = ontology_writer_->createInstanceLater("knowrob:'RotationMatrix2D'");
+	ontology_writer_->setStringProperty(pose2d_instance_name, "knowrob:'orientation'", rotation_matrix_instance_name);
 	
 	// Set elements of rotation matrix
 	float cos_theta = cos(theta);
 	float sin_theta = sin(theta);
-	oa_->setFloatProperty(rotation_matrix_instance_name, "knowrob:'m00'", cos_theta);
-	oa_->setFloatProperty(rotation_matrix_instance_name, "knowrob:'m01'", -sin_theta);
-	oa_->setFloatProperty(rotation_matrix_instance_name, "knowrob:'m10'", sin_theta);
-	oa_->setFloatProperty(rotation_matrix_instance_name, "knowrob:'m11'", cos_theta);
+	ontology_writer_->setFloatProperty(rotation_matrix_instance_name, "knowrob:'m00'", cos_theta);
+	ontology_writer_->setFloatProperty(rotation_matrix_instance_name, "knowrob:'m01'", -sin_theta);
+	ontology_writer_->setFloatProperty(rotation_matrix_instance_name, "knowrob:'m10'", sin_theta);
+	ontology_writer_->setFloatProperty(rotation_matrix_instance_name, "knowrob:'m11'", cos_theta);
 
 	std::string predicate = pose2d_instance_name.substr(pose2d_instance_name.find("#") + 1);
 	Waypoint* waypoint = new Waypoint(pose2d_instance_name, predicate, x, y, theta);
 	
-	std::cout << "Created a Pose2D instance with the name: " << pose2d_instance_name << " and with the rotation matrix: " << rotation_matrix_instance_name << "!" << std::endl;
+	std::cout << "Created a Pose2D instance with the name: " << pose2d_instance_name << "!" << std::endl;
 	return *waypoint;
 }
 #else
@@ -10,6 +10,7 @@
 #include <ros/ros.h>
 
 class OntolAccess;
+class OntologyWriter;
 
 struct Waypoint
 {
@@ -78,8 +79,18 @@ struct Waypoint
 	
 	static void initWaypoints(ros::NodeHandle& ros_node, OntolAccess& oa);
 	
-	static ros::ServiceClient create_instances_client_;
+	/**
+	 * Use another ontology writer for the waypoints, e.g. a @ref{LocalOntologyWriter}. It is not deleted.
+	 */
+	static void setOntologyWriter(OntologyWriter& ontology_writer);
+	
+	/**
+	 * The properties of the waypoints are only stored in the ontology when this writer is flushed.
+	 */
+	static OntologyWriter& getOntologyWriter() { return *ontology_writer_; }
+	
 	static OntolAccess *oa_; // Interface to gain access to the ontology.
+	static OntologyWriter* ontology_writer_; // Stores the waypoints in the ontology.
 	
 	std::string ontology_id_; // The handle by which this waypoint is stored in the ontology.
 	std::string predicate_; // The name by which this inspection point is known in the planner.
@@ -89,52 +100,6 @@ struct Waypoint
 	static unsigned int waypoint_id_;
 };
 
-struct WaypointNode : public std::binary_function<WaypointNode*, WaypointNode*, bool>
-{
-	WaypointNode()
-	{
-		
-	}
-	
-	WaypointNode(Waypoint& waypoint, WaypointNode* parent, Waypoint& to, float edge_cost, const std::vector<WaypointNode*>& path)
-		: waypoint_(&waypoint), to_(&to), path_(path)
-	{
-		path_.push_back(this);
-		
-		// Determine whether we went 'straight' or whether we took a turn.
-		cost_ = edge_cost;
-		
-		if (parent != NULL)
-		{
-			cost_ += parent->cost_;
-		}
-		
-		estimated_cost_to_goal_ = waypoint.getDistanceTo(to);
-	}
-	
-	/**
-	 * Generate children for this node.
-	 */
-	void getChildren(std::vector<WaypointNode*>& children)
-	{
-		for (std::vector<std::pair<float, Waypoint*> >::const_iterator ci = waypoint_->edges_.begin(); ci != waypoint_->edges_.end(); ++ci)
-		{
-			children.push_back(new WaypointNode(*(*ci).second, this, *to_, (*ci).first, path_));
-		}
-	}
-	
-	bool operator()(const WaypointNode* lhs, const WaypointNode* rhs) const
-	{
-		return lhs->cost_ + lhs->estimated_cost_to_goal_ > rhs->cost_ + rhs->estimated_cost_to_goal_;
-	}
-	
-	Waypoint* waypoint_;
-	Waypoint* to_;
-	float cost_;
-	float estimated_cost_to_goal_;
- 	std::vector<WaypointNode*> path_;
-};
-
 std::ostream& operator<<(std::ostream& os, const Waypoint& waypoint);
 
 #endif
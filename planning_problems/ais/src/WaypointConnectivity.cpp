@@ -0,0 +1,104 @@
+#include <turtlebot_planner/Ontology/WaypointConnectivity.h>
+
+#include <algorithm>
+
+void WaypointConnectivity::setTargets(const std::vector<Vector2D>& view_points, const std::vector<const Face*>& faces)
+{
+	bool same_view_points = view_points.size() == view_points_.size();
+	for (unsigned int i = 0; same_view_points && i < view_points.size(); ++i)
+	{
+		same_view_points = view_points[i].x_ == view_points_[i].x_ && view_points[i].y_ == view_points_[i].y_;
+	}
+	
+	if (same_view_points && faces == faces_)
+	{
+		return;
+	}
+	
+	view_points_ = view_points;
+	faces_ = faces;
+	waypoint_ids_.clear();
+	waypoints_.clear();
+	parents_.clear();
+	ranks_.clear();
+	observations_.clear();
+	nr_observed_.clear();
+}
+
+int WaypointConnectivity::getId(const Waypoint& waypoint) const
+{
+	std::map<const Waypoint*, unsigned int>::const_iterator ci = waypoint_ids_.find(&waypoint);
+	if (ci == waypoint_ids_.end())
+	{
+		return -1;
+	}
+	return (*ci).second;
+}
+
+unsigned int WaypointConnectivity::addWaypoint(const Waypoint& waypoint, const std::vector<bool>& observations)
+{
+	unsigned int waypoint_id = parents_.size();
+	waypoint_ids_[&waypoint] = waypoint_id;
+	waypoints_.push_back(&waypoint);
+	parents_.push_back(waypoint_id);
+	ranks_.push_back(0);
+	observations_.push_back(observations);
+	nr_observed_.push_back(std::count(observations.begin(), observations.end(), true));
+	return waypoint_id;
+}
+
+void WaypointConnectivity::connect(unsigned int waypoint_id, unsigned int other_waypoint_id)
+{
+	unsigned int root = find(waypoint_id);
+	unsigned int other_root = find(other_waypoint_id);
+	if (root == other_root)
+	{
+		return;
+	}
+	
+	if (ranks_[root] < ranks_[other_root])
+	{
+		std::swap(root, other_root);
+	}
+	parents_[other_root] = root;
+	if (ranks_[root] == ranks_[other_root])
+	{
+		++ranks_[root];
+	}
+	
+	// The merged component observes everything either of them did.
+	std::vector<bool>& observations = observations_[root];
+	const std::vector<bool>& other_observations = observations_[other_root];
+	for (unsigned int i = 0; i < observations.size(); ++i)
+	{
+		if (other_observations[i] && !observations[i])
+		{
+			observations[i] = true;
+			++nr_observed_[root];
+		}
+	}
+	observations_[other_root].clear();
+}
+
+bool WaypointConnectivity::observesAllTargets(unsigned int waypoint_id)
+{
+	return nr_observed_[find(waypoint_id)] == faces_.size() + view_points_.size();
+}
+
+unsigned int WaypointConnectivity::find(unsigned int waypoint_id)
+{
+	unsigned int root = waypoint_id;
+	while (parents_[root] != root)
+	{
+		root = parents_[root];
+	}
+	
+	// Point everything on the way directly to the root.
+	while (parents_[waypoint_id] != root)
+	{
+		unsigned int parent = parents_[waypoint_id];
+		parents_[waypoint_id] = root;
+		waypoint_id = parent;
+	}
+	return root;
+}
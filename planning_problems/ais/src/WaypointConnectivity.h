@@ -0,0 +1,76 @@
+#ifndef TURTLEBOT_PLANNER_ONTOLOGY_WAYPOINT_CONNECTIVITY_H
+#define TURTLEBOT_PLANNER_ONTOLOGY_WAYPOINT_CONNECTIVITY_H
+
+#include <vector>
+#include <map>
+
+#include "Vector2D.h"
+
+class Face;
+class Waypoint;
+
+/**
+ * The connected components of the waypoints in a scene, maintained as a union-find structure. For every
+ * component we also keep track of which faces and view points can be observed from its waypoints. Waypoints
+ * are only ever added, so a waypoint that has been added before costs nothing and a new waypoint only needs
+ * to be tested against the waypoints that are not yet in its component.
+ *
+ * The waypoints must not be deleted while they are part of this structure.
+ */
+class WaypointConnectivity
+{
+public:
+	/**
+	 * Set the faces and view points that need to be observed. If these differ from the previous ones, all
+	 * the waypoints are removed.
+	 */
+	void setTargets(const std::vector<Vector2D>& view_points, const std::vector<const Face*>& faces);
+	
+	/**
+	 * @return The id of @ref{waypoint}, or -1 if it has not been added.
+	 */
+	int getId(const Waypoint& waypoint) const;
+	
+	/**
+	 * Add a waypoint as a component of its own.
+	 * @param observations For every face and then every view point (see @ref{setTargets}) whether it can be
+	 * observed from @ref{waypoint}.
+	 * @return The id of the waypoint.
+	 */
+	unsigned int addWaypoint(const Waypoint& waypoint, const std::vector<bool>& observations);
+	
+	/**
+	 * Merge the components of the waypoints with ids @ref{waypoint_id} and @ref{other_waypoint_id}.
+	 */
+	void connect(unsigned int waypoint_id, unsigned int other_waypoint_id);
+	
+	bool isConnected(unsigned int waypoint_id, unsigned int other_waypoint_id) { return find(waypoint_id) == find(other_waypoint_id); }
+	
+	/**
+	 * @return True if all the faces and view points can be observed from the component of @ref{waypoint_id}.
+	 */
+	bool observesAllTargets(unsigned int waypoint_id);
+	
+	/**
+	 * @return The number of faces and view points that can be observed from the component of @ref{waypoint_id}.
+	 */
+	unsigned int getNumberOfObservedTargets(unsigned int waypoint_id) { return nr_observed_[find(waypoint_id)]; }
+	
+	unsigned int getNumberOfWaypoints() const { return parents_.size(); }
+	const Waypoint& getWaypoint(unsigned int waypoint_id) const { return *waypoints_[waypoint_id]; }
+	
+private:
+	unsigned int find(unsigned int waypoint_id);
+	
+	std::vector<Vector2D> view_points_;
+	std::vector<const Face*> faces_;
+	
+	std::map<const Waypoint*, unsigned int> waypoint_ids_;
+	std::vector<const Waypoint*> waypoints_;
+	std::vector<unsigned int> parents_;
+	std::vector<unsigned int> ranks_;
+	std::vector<std::vector<bool> > observations_; // The targets observed by a component, only valid for the roots.
+	std::vector<unsigned int> nr_observed_;        // The number of targets observed by a component, only valid for the roots.
+};
+
+#endif
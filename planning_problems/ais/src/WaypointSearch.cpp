@@ -0,0 +1,274 @@
+#include "WaypointSearch.h"
+
+#include <algorithm>
+
+#include "Waypoint.h"
+
+bool WaypointSearch::findPath(Waypoint& from, Waypoint& to, std::vector<Waypoint*>& path)
+{
+	clear();
+	nodes_[getNode(to, &to)].is_target_ = true;
+	search(from, &to, 1);
+	getPath(to, path);
+	return !path.empty();
+}
+
+void WaypointSearch::findPaths(Waypoint& from, const std::vector<Waypoint*>& targets, std::vector<std::vector<Waypoint*> >& paths)
+{
+	clear();
+	search(from, NULL, setTargets(targets));
+	
+	paths.resize(targets.size());
+	for (unsigned int i = 0; i < targets.size(); ++i)
+	{
+		getPath(*targets[i], paths[i]);
+	}
+}
+
+unsigned int WaypointSearch::addPathWaypoints(Waypoint& from, const std::vector<Waypoint*>& targets, std::set<Waypoint*>& waypoints)
+{
+	clear();
+	search(from, NULL, setTargets(targets));
+	
+	unsigned int nr_reached_targets = 0;
+	for (std::vector<Waypoint*>::const_iterator ci = targets.begin(); ci != targets.end(); ++ci)
+	{
+		int target = findNode(**ci);
+		if (target == -1 || !nodes_[target].closed_)
+		{
+			continue;
+		}
+		++nr_reached_targets;
+		
+		// The rest of the path is known once we reach a node that is on the path to another target.
+		for (int node_id = target; node_id != -1 && !nodes_[node_id].is_on_path_; node_id = nodes_[node_id].parent_)
+		{
+			nodes_[node_id].is_on_path_ = true;
+			waypoints.insert(nodes_[node_id].waypoint_);
+		}
+	}
+	return nr_reached_targets;
+}
+
+unsigned int WaypointSearch::setTargets(const std::vector<Waypoint*>& targets)
+{
+	unsigned int nr_targets = 0;
+	for (std::vector<Waypoint*>::const_iterator ci = targets.begin(); ci != targets.end(); ++ci)
+	{
+		Node& node = nodes_[getNode(**ci, NULL)];
+		if (!node.is_target_)
+		{
+			node.is_target_ = true;
+			++nr_targets;
+		}
+	}
+	return nr_targets;
+}
+
+void WaypointSearch::search(Waypoint& from, const Waypoint* to, unsigned int nr_targets)
+{
+	unsigned int start = getNode(from, to);
+	nodes_[start].cost_ = 0;
+	pushHeap(start);
+	
+	while (!heap_.empty() && nr_targets > 0)
+	{
+		unsigned int current = popHeap();
+		nodes_[current].closed_ = true;
+		if (nodes_[current].is_target_)
+		{
+			--nr_targets;
+		}
+		
+		// Note that getNode may grow nodes_, so we do not keep references to its elements.
+		const std::vector<std::pair<float, Waypoint*> >& edges = nodes_[current].waypoint_->edges_;
+		for (std::vector<std::pair<float, Waypoint*> >::const_iterator ci = edges.begin(); ci != edges.end(); ++ci)
+		{
+			unsigned int child = getNode(*(*ci).second, to);
+			float cost = nodes_[current].cost_ + (*ci).first;
+			if (nodes_[child].closed_ || (nodes_[child].parent_ != -1 && cost >= nodes_[child].cost_))
+			{
+				continue;
+			}
+			
+			nodes_[child].parent_ = current;
+			nodes_[child].cost_ = cost;
+			if (nodes_[child].heap_index_ == -1)
+			{
+				pushHeap(child);
+			}
+			else
+			{
+				siftUp(nodes_[child].heap_index_);
+			}
+		}
+	}
+}
+
+unsigned int WaypointSearch::getNode(Waypoint& waypoint, const Waypoint* to)
+{
+	if (slots_.empty())
+	{
+		slots_.resize(64, -1);
+	}
+	
+	unsigned int slot = findSlot(waypoint);
+	if (slots_[slot] != -1)
+	{
+		return slots_[slot];
+	}
+	
+	Node node;
+	node.waypoint_ = &waypoint;
+	node.parent_ = -1;
+	node.cost_ = 0;
+	node.estimated_cost_to_goal_ = to == NULL ? 0 : waypoint.getDistanceTo(*to);
+	node.heap_index_ = -1;
+	node.closed_ = false;
+	node.is_target_ = false;
+	node.is_on_path_ = false;
+	node.slot_ = slot;
+	
+	unsigned int node_id = nodes_.size();
+	nodes_.push_back(node);
+	slots_[slot] = node_id;
+	
+	// Keep the table at most half full, so the probe sequences stay short.
+	if (nodes_.size() * 2 > slots_.size())
+	{
+		growSlots();
+	}
+	return node_id;
+}
+
+int WaypointSearch::findNode(const Waypoint& waypoint) const
+{
+	if (slots_.empty())
+	{
+		return -1;
+	}
+	return slots_[findSlot(waypoint)];
+}
+
+unsigned int WaypointSearch::findSlot(const Waypoint& waypoint) const
+{
+	// The low bits of the addresses are the same for all the waypoints due to their alignment.
+	unsigned long hash = (reinterpret_cast<unsigned long>(&waypoint) >> 4) * 2654435761ul;
+	unsigned int mask = slots_.size() - 1;
+	for (unsigned int slot = hash & mask; ; slot = (slot + 1) & mask)
+	{
+		if (slots_[slot] == -1 || nodes_[slots_[slot]].waypoint_ == &waypoint)
+		{
+			return slot;
+		}
+	}
+}
+
+void WaypointSearch::growSlots()
+{
+	slots_.assign(slots_.size() * 2, -1);
+	for (unsigned int node_id = 0; node_id < nodes_.size(); ++node_id)
+	{
+		unsigned int slot = findSlot(*nodes_[node_id].waypoint_);
+		slots_[slot] = node_id;
+		nodes_[node_id].slot_ = slot;
+	}
+}
+
+void WaypointSearch::getPath(const Waypoint& target, std::vector<Waypoint*>& path) const
+{
+	path.clear();
+	int target_id = findNode(target);
+	if (target_id == -1 || !nodes_[target_id].closed_)
+	{
+		return;
+	}
+	
+	for (int node_id = target_id; node_id != -1; node_id = nodes_[node_id].parent_)
+	{
+		path.push_back(nodes_[node_id].waypoint_);
+	}
+	std::reverse(path.begin(), path.end());
+}
+
+void WaypointSearch::clear()
+{
+	// Only empty the slots that are in use, the table keeps its size.
+	for (std::vector<Node>::const_iterator ci = nodes_.begin(); ci != nodes_.end(); ++ci)
+	{
+		slots_[(*ci).slot_] = -1;
+	}
+	nodes_.clear();
+	heap_.clear();
+}
+
+bool WaypointSearch::isCheaper(unsigned int lhs, unsigned int rhs) const
+{
+	return nodes_[lhs].cost_ + nodes_[lhs].estimated_cost_to_goal_ < nodes_[rhs].cost_ + nodes_[rhs].estimated_cost_to_goal_;
+}
+
+void WaypointSearch::pushHeap(unsigned int node_id)
+{
+	heap_.push_back(node_id);
+	nodes_[node_id].heap_index_ = heap_.size() - 1;
+	siftUp(heap_.size() - 1);
+}
+
+unsigned int WaypointSearch::popHeap()
+{
+	unsigned int top = heap_[0];
+	nodes_[top].heap_index_ = -1;
+	heap_[0] = heap_.back();
+	heap_.pop_back();
+	if (!heap_.empty())
+	{
+		nodes_[heap_[0]].heap_index_ = 0;
+		siftDown(0);
+	}
+	return top;
+}
+
+void WaypointSearch::siftUp(int heap_index)
+{
+	unsigned int node_id = heap_[heap_index];
+	while (heap_index > 0)
+	{
+		int parent_index = (heap_index - 1) / 2;
+		if (!isCheaper(node_id, heap_[parent_index]))
+		{
+			break;
+		}
+		heap_[heap_index] = heap_[parent_index];
+		nodes_[heap_[heap_index]].heap_index_ = heap_index;
+		heap_index = parent_index;
+	}
+	heap_[heap_index] = node_id;
+	nodes_[node_id].heap_index_ = heap_index;
+}
+
+void WaypointSearch::siftDown(int heap_index)
+{
+	unsigned int node_id = heap_[heap_index];
+	int size = heap_.size();
+	while (true)
+	{
+		int child_index = heap_index * 2 + 1;
+		if (child_index >= size)
+		{
+			break;
+		}
+		if (child_index + 1 < size && isCheaper(heap_[child_index + 1], heap_[child_index]))
+		{
+			++child_index;
+		}
+		if (!isCheaper(heap_[child_index], node_id))
+		{
+			break;
+		}
+		heap_[heap_index] = heap_[child_index];
+		nodes_[heap_[heap_index]].heap_index_ = heap_index;
+		heap_index = child_index;
+	}
+	heap_[heap_index] = node_id;
+	nodes_[node_id].heap_index_ = heap_index;
+}
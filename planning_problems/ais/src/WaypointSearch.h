@@ -0,0 +1,101 @@
+#ifndef FLYING_TURTLEBOT_PLANNING_WAYPOINT_SEARCH_H
+#define FLYING_TURTLEBOT_PLANNING_WAYPOINT_SEARCH_H
+
+#include <vector>
+#include <set>
+
+struct Waypoint;
+
+/**
+ * Shortest paths over the edges of the waypoints. Every node only stores the index of its parent and the
+ * open nodes are kept in a binary heap that supports decreasing their cost. The nodes of the waypoints are
+ * found through an open addressing hash table on their addresses. The nodes, the table and the heap are
+ * reused by subsequent searches, so a search does not allocate once the buffers are large enough. A search
+ * modifies these buffers, so a single instance cannot be used by multiple threads at the same time.
+ */
+class WaypointSearch
+{
+public:
+	/**
+	 * Find the shortest path from @ref{from} to @ref{to} using A*.
+	 * @param path The waypoints on the path, including @ref{from} and @ref{to}, will be stored here. It is empty if
+	 * there is no path.
+	 * @return True if a path was found, false otherwise.
+	 */
+	bool findPath(Waypoint& from, Waypoint& to, std::vector<Waypoint*>& path);
+	
+	/**
+	 * Find the shortest paths from @ref{from} to all @ref{targets} in a single Dijkstra search.
+	 * @param paths For every target the path to it (see @ref{findPath}) will be stored here, in the same order.
+	 */
+	void findPaths(Waypoint& from, const std::vector<Waypoint*>& targets, std::vector<std::vector<Waypoint*> >& paths);
+	
+	/**
+	 * Find the shortest paths from @ref{from} to all @ref{targets} in a single Dijkstra search and add the waypoints on
+	 * these paths to @ref{waypoints}, without building the paths. The parents are followed from every target until a
+	 * waypoint that is on the path to a previous target, so every waypoint of the shortest path tree is visited once.
+	 * @return The number of targets that can be reached.
+	 */
+	unsigned int addPathWaypoints(Waypoint& from, const std::vector<Waypoint*>& targets, std::set<Waypoint*>& waypoints);
+	
+private:
+	struct Node
+	{
+		Waypoint* waypoint_;
+		int parent_;                  // The index of the node we came from, -1 for the start.
+		float cost_;                  // The cost of the cheapest path found so far.
+		float estimated_cost_to_goal_;
+		int heap_index_;              // The position in heap_, -1 if the node is not open.
+		bool closed_;
+		bool is_target_;
+		bool is_on_path_;             // True if the node is on the path to a target, see addPathWaypoints.
+		unsigned int slot_;           // The position in slots_.
+	};
+	
+	/**
+	 * Search from @ref{from} until all the targets are closed.
+	 * @param to The goal the distance estimate is based on, NULL to search without an estimate.
+	 */
+	void search(Waypoint& from, const Waypoint* to, unsigned int nr_targets);
+	
+	/**
+	 * Mark all @ref{targets} as targets of the next search.
+	 * @return The number of distinct targets.
+	 */
+	unsigned int setTargets(const std::vector<Waypoint*>& targets);
+	
+	/**
+	 * Get the index of the node of @ref{waypoint}, create it if it does not exist yet.
+	 */
+	unsigned int getNode(Waypoint& waypoint, const Waypoint* to);
+	
+	/**
+	 * @return The index of the node of @ref{waypoint}, -1 if it does not exist.
+	 */
+	int findNode(const Waypoint& waypoint) const;
+	
+	/**
+	 * @return The position of @ref{waypoint} in slots_, or of the empty slot where it belongs if it has no node.
+	 */
+	unsigned int findSlot(const Waypoint& waypoint) const;
+	
+	/**
+	 * Double the size of slots_ and store all the nodes again.
+	 */
+	void growSlots();
+	
+	void getPath(const Waypoint& target, std::vector<Waypoint*>& path) const;
+	void clear();
+	
+	bool isCheaper(unsigned int lhs, unsigned int rhs) const;
+	void pushHeap(unsigned int node_id);
+	unsigned int popHeap();
+	void siftUp(int heap_index);
+	void siftDown(int heap_index);
+	
+	std::vector<Node> nodes_;
+	std::vector<int> slots_;         // The ids of the nodes, -1 for an empty slot. The size is a power of two.
+	std::vector<unsigned int> heap_; // The ids of the open nodes.
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <stdlib.h>
+#include <time.h>
+
+#include <turtlebot_planner/Ontology/Face.h>
+#include <turtlebot_planner/Ontology/Shape.h>
+#include <turtlebot_planner/Ontology/RotationMatrix.h>
+
+/**
+ * Load thousands of faces through Face::getFace, half of which are (nearly) duplicates of earlier faces, and
+ * compare it with scanning all the stored faces for a similar one. Usage: face_dedup [number of faces]
+ */
+
+static float getRandom(float max)
+{
+	return max * rand() / (float)RAND_MAX;
+}
+
+static double getSeconds(clock_t start)
+{
+	return (clock() - start) / (double)CLOCKS_PER_SEC;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int nr_faces = argc > 1 ? atoi(argv[1]) : 4000;
+	srand(0);
+	
+	// The faces print themselves when they are created.
+	std::stringstream ignored_output;
+	std::streambuf* cout_buffer = std::cout.rdbuf(ignored_output.rdbuf());
+	
+	// A few differently coloured faces that are placed all over the map.
+	RotationMatrix identity(1, 0, 0, 1);
+	Shape prototype_shape(Vector3D(0, 0, 0), identity);
+	std::vector<Face*> prototypes;
+	for (int hue = 0; hue < 4; ++hue)
+	{
+		prototypes.push_back(new Face(prototype_shape, "", Vector3D(0, 0, 0), Vector3D(1, 0, 0), Vector3D(0, 1, 0), hue * 60, 200, 200, false));
+	}
+	
+	std::vector<Shape*> shapes;
+	std::vector<Face*> faces;
+	for (unsigned int i = 0; i < nr_faces; ++i)
+	{
+		Vector3D location(getRandom(100.0f), getRandom(100.0f), 0);
+		if (i % 2 == 1)
+		{
+			// Move an earlier face by less than the similarity threshold.
+			location = shapes[rand() % shapes.size()]->getLocation() + Vector3D(getRandom(0.02f), getRandom(0.02f), 0);
+		}
+		Shape* shape = new Shape(location, identity);
+		shapes.push_back(shape);
+		faces.push_back(new Face(*shape, *prototypes[rand() % prototypes.size()], false));
+	}
+	
+	clock_t start = clock();
+	for (unsigned int i = 0; i < nr_faces; ++i)
+	{
+		Face::getFace(*shapes[i], *faces[i], false);
+	}
+	double bucket_time = getSeconds(start);
+	unsigned int nr_unique_faces = Face::getFaces().size();
+	
+	start = clock();
+	std::vector<Face*> linear_faces;
+	for (unsigned int i = 0; i < nr_faces; ++i)
+	{
+		bool found_similar_face = false;
+		for (std::vector<Face*>::const_iterator ci = linear_faces.begin(); ci != linear_faces.end(); ++ci)
+		{
+			if ((*ci)->isSimilarTo(*faces[i]))
+			{
+				found_similar_face = true;
+				break;
+			}
+		}
+		if (!found_similar_face)
+		{
+			linear_faces.push_back(faces[i]);
+		}
+	}
+	double linear_time = getSeconds(start);
+	std::cout.rdbuf(cout_buffer);
+	
+	std::cout << nr_faces << " faces." << std::endl;
+	std::cout << "Face::getFace: " << bucket_time << "s, " << nr_unique_faces << " unique faces." << std::endl;
+	std::cout << "Linear scan: " << linear_time << "s, " << linear_faces.size() << " unique faces." << std::endl;
+	
+	Face::deleteFaces();
+	return 0;
+}
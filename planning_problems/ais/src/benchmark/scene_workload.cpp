@@ -0,0 +1,296 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <turtlebot_planner/Ontology/Scene.h>
+#include <turtlebot_planner/Ontology/SceneFile.h>
+#include <turtlebot_planner/Ontology/Face.h>
+#include <turtlebot_planner/Ontology/FaceGrid.h>
+#include <turtlebot_planner/Ontology/Vector2D.h>
+#include "../Waypoint.h"
+
+/**
+ * Run the geometric queries of the problem generation over scenes that are stored in a scene file (see
+ * SceneFile), without ROS or the ontology, and report the time spent in every stage.
+ *
+ * Usage: scene_workload <scene file> [number of waypoints] [number of view points]
+ *        scene_workload --generate <scene file> [number of scenes] [number of shapes]
+ *        scene_workload --snapshot <scene file> <snapshot file>
+ *        scene_workload --threads <scene file> [number of threads] [number of waypoints]
+ *
+ * The scene file can be a text file or a snapshot, --snapshot converts a scene file into a snapshot. --threads
+ * runs the canTraverse queries in several threads that share the cold shape query cache, and compares every
+ * answer with the one of a face grid of the scene.
+ */
+
+static float getRandom(float min, float max)
+{
+	return min + (max - min) * rand() / (float)RAND_MAX;
+}
+
+static double getSeconds(clock_t start)
+{
+	return (clock() - start) / (double)CLOCKS_PER_SEC;
+}
+
+/**
+ * Write a scene file with boxes in a 20x20 area. Every scene contains most of the boxes, like the scenes
+ * of the ontology that only differ in a few objects.
+ */
+static void generateSceneFile(const std::string& file_name, unsigned int nr_scenes, unsigned int nr_shapes)
+{
+	std::vector<std::pair<float, float> > locations;
+	for (unsigned int i = 0; i < nr_shapes; ++i)
+	{
+		locations.push_back(std::make_pair(getRandom(-10.0f, 10.0f), getRandom(-10.0f, 10.0f)));
+	}
+	
+	std::ofstream file(file_name.c_str());
+	for (unsigned int scene_nr = 0; scene_nr < nr_scenes; ++scene_nr)
+	{
+		file << "scene scene" << scene_nr << " " << 1.0f / nr_scenes << std::endl;
+		for (unsigned int i = 0; i < nr_shapes; ++i)
+		{
+			if (rand() % 5 == 0) continue;
+			
+			file << "shape box" << i << " " << locations[i].first << " " << locations[i].second << " 0 0" << std::endl;
+			file << "face box" << i << "_south -0.5 -0.5 0 0.5 -0.5 0 0 -1 0 " << (i % 6) * 30 << " 100 100 0" << std::endl;
+			file << "face box" << i << "_east 0.5 -0.5 0 0.5 0.5 0 1 0 0 " << (i % 6) * 30 << " 100 100 0" << std::endl;
+			file << "face box" << i << "_north 0.5 0.5 0 -0.5 0.5 0 0 1 0 " << (i % 6) * 30 << " 100 100 0" << std::endl;
+			file << "face box" << i << "_west -0.5 0.5 0 -0.5 -0.5 0 -1 0 0 " << (i % 6) * 30 << " 100 100 0" << std::endl;
+		}
+	}
+}
+
+struct ThreadCheck
+{
+	const std::vector<Scene*>* scenes_;
+	const std::vector<Vector2D>* points_;
+	const std::vector<std::vector<bool> >* expected_;
+	unsigned int first_scene_;
+	unsigned int nr_mismatches_;
+};
+
+static void* runThreadCheck(void* arg)
+{
+	ThreadCheck& check = *static_cast<ThreadCheck*>(arg);
+	const std::vector<Vector2D>& points = *check.points_;
+	
+	// Every thread starts at another scene, so the threads store the results of the shared shapes concurrently.
+	for (unsigned int i = 0; i < check.scenes_->size(); ++i)
+	{
+		unsigned int scene_nr = (check.first_scene_ + i) % check.scenes_->size();
+		const Scene& scene = *(*check.scenes_)[scene_nr];
+		unsigned int k = 0;
+		for (unsigned int j = 0; j < points.size(); ++j)
+		{
+			for (unsigned int l = j + 1; l < points.size(); ++l)
+			{
+				if (scene.canConnect(points[j], points[l]) != (*check.expected_)[scene_nr][k++])
+				{
+					++check.nr_mismatches_;
+				}
+			}
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Check that the answers of canConnect do not depend on the order in which threads fill the shape query cache.
+ * @return The number of answers that differ from those of a face grid of the scene.
+ */
+static unsigned int checkThreads(const std::vector<Scene*>& scenes, unsigned int nr_threads, unsigned int nr_points)
+{
+	std::vector<Vector2D> points;
+	for (unsigned int i = 0; i < nr_points; ++i)
+	{
+		points.push_back(Vector2D(getRandom(-11.0f, 11.0f), getRandom(-11.0f, 11.0f)));
+	}
+	
+	// The face grids do not use the cache, so the cache stays cold for the threads.
+	std::vector<std::vector<bool> > expected(scenes.size());
+	for (unsigned int i = 0; i < scenes.size(); ++i)
+	{
+		FaceGrid face_grid(scenes[i]->getShapes());
+		for (unsigned int j = 0; j < points.size(); ++j)
+		{
+			for (unsigned int k = j + 1; k < points.size(); ++k)
+			{
+				expected[i].push_back(!face_grid.isNearSegment(points[j], points[k], 0.25f));
+			}
+		}
+	}
+	
+	std::vector<pthread_t> threads(nr_threads);
+	std::vector<ThreadCheck> checks(nr_threads);
+	for (unsigned int i = 0; i < nr_threads; ++i)
+	{
+		ThreadCheck check = { &scenes, &points, &expected, i * (unsigned int)scenes.size() / nr_threads, 0 };
+		checks[i] = check;
+		pthread_create(&threads[i], NULL, runThreadCheck, &checks[i]);
+	}
+	unsigned int nr_mismatches = 0;
+	for (unsigned int i = 0; i < nr_threads; ++i)
+	{
+		pthread_join(threads[i], NULL);
+		nr_mismatches += checks[i].nr_mismatches_;
+	}
+	return nr_mismatches;
+}
+
+int main(int argc, char** argv)
+{
+	srand(0);
+	if (argc > 2 && std::string(argv[1]) == "--generate")
+	{
+		generateSceneFile(argv[2], argc > 3 ? atoi(argv[3]) : 10, argc > 4 ? atoi(argv[4]) : 50);
+		return 0;
+	}
+	if (argc > 3 && std::string(argv[1]) == "--snapshot")
+	{
+		std::vector<Scene*> scenes;
+		return SceneFile::load(argv[2], NULL, scenes) && SceneFile::saveSnapshot(argv[3], scenes, argv[2]) ? 0 : 1;
+	}
+	if (argc > 2 && std::string(argv[1]) == "--threads")
+	{
+		std::vector<Scene*> scenes;
+		if (!SceneFile::load(argv[2], NULL, scenes))
+		{
+			return 1;
+		}
+		unsigned int nr_threads = argc > 3 ? atoi(argv[3]) : 8;
+		unsigned int nr_mismatches = checkThreads(scenes, nr_threads, argc > 4 ? atoi(argv[4]) : 150);
+		std::cout << "canTraverse in " << nr_threads << " threads: " << nr_mismatches << " mismatches" << std::endl;
+		return nr_mismatches == 0 ? 0 : 1;
+	}
+	if (argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <scene file> [number of waypoints] [number of view points]" << std::endl;
+		std::cerr << "       " << argv[0] << " --generate <scene file> [number of scenes] [number of shapes]" << std::endl;
+		std::cerr << "       " << argv[0] << " --snapshot <scene file> <snapshot file>" << std::endl;
+		std::cerr << "       " << argv[0] << " --threads <scene file> [number of threads] [number of waypoints]" << std::endl;
+		return 1;
+	}
+	unsigned int nr_waypoints = argc > 2 ? atoi(argv[2]) : 100;
+	unsigned int nr_view_points = argc > 3 ? atoi(argv[3]) : 10;
+	
+	// Load the scenes.
+	clock_t start = clock();
+	std::vector<Scene*> scenes;
+	if (!SceneFile::load(argv[1], NULL, scenes))
+	{
+		return 1;
+	}
+	std::cout << "Loading " << scenes.size() << " scenes with " << Face::getFaces().size() << " unique faces: " << getSeconds(start) << "s" << std::endl;
+	
+	std::vector<Waypoint*> waypoints;
+	for (unsigned int i = 0; i < nr_waypoints; ++i)
+	{
+		std::stringstream ss;
+		ss << "wp" << i;
+		waypoints.push_back(new Waypoint(ss.str(), ss.str(), getRandom(-11.0f, 11.0f), getRandom(-11.0f, 11.0f), 0));
+	}
+	std::vector<Vector2D> view_points;
+	for (unsigned int i = 0; i < nr_view_points; ++i)
+	{
+		view_points.push_back(Vector2D(getRandom(-11.0f, 11.0f), getRandom(-11.0f, 11.0f)));
+	}
+	
+	// The stages of the problem generation.
+	unsigned int nr_results = 0;
+	start = clock();
+	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci)
+	{
+		for (unsigned int i = 0; i < waypoints.size(); ++i)
+		{
+			for (std::vector<Vector2D>::const_iterator ci2 = view_points.begin(); ci2 != view_points.end(); ++ci2)
+			{
+				nr_results += (*ci)->canConnect(*ci2, Vector2D(waypoints[i]->x_, waypoints[i]->y_));
+			}
+		}
+	}
+	std::cout << "visibleFrom: " << getSeconds(start) << "s (" << nr_results << " facts)" << std::endl;
+	
+	nr_results = 0;
+	start = clock();
+	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci)
+	{
+		for (unsigned int i = 0; i < waypoints.size(); ++i)
+		{
+			for (unsigned int j = i + 1; j < waypoints.size(); ++j)
+			{
+				nr_results += (*ci)->canConnect(Vector2D(waypoints[i]->x_, waypoints[i]->y_), Vector2D(waypoints[j]->x_, waypoints[j]->y_));
+			}
+		}
+	}
+	std::cout << "canTraverse: " << getSeconds(start) << "s (" << nr_results << " facts)" << std::endl;
+	
+	nr_results = 0;
+	start = clock();
+	std::vector<const Face*> all_faces(Face::getFaces().begin(), Face::getFaces().end());
+	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci)
+	{
+		for (unsigned int i = 0; i < waypoints.size(); ++i)
+		{
+			std::vector<bool> is_visible;
+			(*ci)->canSee(all_faces, Vector2D(waypoints[i]->x_, waypoints[i]->y_), is_visible);
+			nr_results += std::count(is_visible.begin(), is_visible.end(), true);
+		}
+	}
+	std::cout << "canObserve: " << getSeconds(start) << "s (" << nr_results << " facts)" << std::endl;
+	
+	nr_results = 0;
+	start = clock();
+	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci)
+	{
+		for (unsigned int i = 0; i < 10000; ++i)
+		{
+			nr_results += (*ci)->isBlocked(Vector2D(getRandom(-11.0f, 11.0f), getRandom(-11.0f, 11.0f)), 0.25f);
+		}
+	}
+	std::cout << "isBlocked: " << getSeconds(start) << "s (" << nr_results << " blocked)" << std::endl;
+	
+	// The first waypoints are the entrance and the exit, some of the others need to be visited.
+	nr_results = 0;
+	start = clock();
+	std::vector<Waypoint*> view_cones(waypoints.begin() + 2, waypoints.begin() + std::min<unsigned int>(waypoints.size(), 7));
+	std::vector<const Face*> faces;
+	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci)
+	{
+		std::vector<Waypoint*> unconnected_view_cones;
+		nr_results += (*ci)->isFullyConnected(*waypoints[0], *waypoints[1], waypoints, view_cones, view_points, faces, unconnected_view_cones);
+	}
+	std::cout << "isFullyConnected: " << getSeconds(start) << "s (" << nr_results << " connected)" << std::endl;
+	
+	nr_results = 0;
+	start = clock();
+	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci)
+	{
+		std::vector<std::vector<Waypoint*> > paths;
+		(*ci)->connectWaypoints(waypoints);
+		(*ci)->findPaths(*waypoints[0], waypoints, paths);
+		for (std::vector<std::vector<Waypoint*> >::const_iterator ci2 = paths.begin(); ci2 != paths.end(); ++ci2)
+		{
+			nr_results += !(*ci2).empty();
+		}
+	}
+	std::cout << "findPaths: " << getSeconds(start) << "s (" << nr_results << " paths)" << std::endl;
+	
+	for (std::vector<Scene*>::const_iterator ci = scenes.begin(); ci != scenes.end(); ++ci)
+	{
+		delete *ci;
+	}
+	for (std::vector<Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
+	{
+		delete *ci;
+	}
+	Face::deleteFaces();
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <time.h>
+
+#include <turtlebot_planner/Ontology/Vector3D.h>
+#include <turtlebot_planner/Ontology/SegmentKernel.h>
+
+/**
+ * Compare the batched segment kernel with testing every face with Vector3D::getDistance, the way
+ * Scene::canConnect used to. Usage: segment_kernel [number of segments] [number of queries]
+ */
+
+static float getRandom(float max)
+{
+	return max * rand() / (float)RAND_MAX;
+}
+
+static double getSeconds(clock_t start)
+{
+	return (clock() - start) / (double)CLOCKS_PER_SEC;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int nr_segments = argc > 1 ? atoi(argv[1]) : 4096;
+	unsigned int nr_queries = argc > 2 ? atoi(argv[2]) : 10000;
+	const float distance = 0.25f;
+	srand(0);
+
+	std::vector<float> x1(nr_segments), y1(nr_segments), x2(nr_segments), y2(nr_segments);
+	std::vector<Vector3D> p1, p2;
+	for (unsigned int i = 0; i < nr_segments; ++i)
+	{
+		x1[i] = getRandom(100.0f);
+		y1[i] = getRandom(100.0f);
+		x2[i] = x1[i] + getRandom(1.0f);
+		y2[i] = y1[i] + getRandom(1.0f);
+		p1.push_back(Vector3D(x1[i], y1[i], 0.0f));
+		p2.push_back(Vector3D(x2[i], y2[i], 0.0f));
+	}
+
+	std::vector<float> queries;
+	for (unsigned int i = 0; i < nr_queries * 4; ++i)
+	{
+		queries.push_back(getRandom(100.0f));
+	}
+
+	unsigned int scalar_hits = 0;
+	clock_t start = clock();
+	for (unsigned int i = 0; i < nr_queries; ++i)
+	{
+		Vector3D from(queries[i * 4], queries[i * 4 + 1], 0.0f);
+		Vector3D to(from.x_ + queries[i * 4 + 2] / 50.0f, from.y_ + queries[i * 4 + 3] / 50.0f, 0.0f);
+		for (unsigned int j = 0; j < nr_segments; ++j)
+		{
+			if (Vector3D::getDistance(from, to, p1[j], p2[j]) < distance)
+			{
+				++scalar_hits;
+				break;
+			}
+		}
+	}
+	double scalar_time = getSeconds(start);
+
+	unsigned int kernel_hits = 0;
+	start = clock();
+	for (unsigned int i = 0; i < nr_queries; ++i)
+	{
+		float from_x = queries[i * 4];
+		float from_y = queries[i * 4 + 1];
+		float to_x = from_x + queries[i * 4 + 2] / 50.0f;
+		float to_y = from_y + queries[i * 4 + 3] / 50.0f;
+		if (SegmentKernel::findSegmentWithin(&x1[0], &y1[0], &x2[0], &y2[0], nr_segments, from_x, from_y, to_x, to_y, distance) != -1)
+		{
+			++kernel_hits;
+		}
+	}
+	double kernel_time = getSeconds(start);
+
+	std::cout << nr_segments << " segments, " << nr_queries << " queries." << std::endl;
+	std::cout << "Vector3D::getDistance: " << scalar_time << "s, " << scalar_hits << " hits." << std::endl;
+	std::cout << "SegmentKernel: " << kernel_time << "s, " << kernel_hits << " hits." << std::endl;
+	return 0;
+}
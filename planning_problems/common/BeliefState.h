@@ -0,0 +1,181 @@
+#ifndef PLANNING_PROBLEMS_BELIEF_STATE_H
+#define PLANNING_PROBLEMS_BELIEF_STATE_H
+
+#include <map>
+#include <vector>
+
+/**
+ * A set of states, stored as a dense bitset over the state ids of a @ref{BeliefState}.
+ */
+struct StateSet
+{
+	StateSet(unsigned int nr_states = 0)
+		: words_((nr_states + 63) / 64, 0)
+	{
+
+	}
+
+	void add(unsigned int state_id)
+	{
+		words_[state_id / 64] |= 1ULL << (state_id % 64);
+	}
+
+	bool contains(unsigned int state_id) const
+	{
+		return (words_[state_id / 64] & (1ULL << (state_id % 64))) != 0;
+	}
+
+	/**
+	 * @return The states that are in both this set and @ref{other}.
+	 */
+	StateSet intersect(const StateSet& other) const
+	{
+		StateSet result(*this);
+		for (unsigned int i = 0; i < words_.size(); ++i)
+		{
+			result.words_[i] &= other.words_[i];
+		}
+		return result;
+	}
+
+	/**
+	 * @return The states that are in this set, @ref{other}, or both.
+	 */
+	StateSet unite(const StateSet& other) const
+	{
+		StateSet result(*this);
+		for (unsigned int i = 0; i < words_.size(); ++i)
+		{
+			result.words_[i] |= other.words_[i];
+		}
+		return result;
+	}
+
+	/**
+	 * @return The states that are in this set but not in @ref{other}.
+	 */
+	StateSet subtract(const StateSet& other) const
+	{
+		StateSet result(*this);
+		for (unsigned int i = 0; i < words_.size(); ++i)
+		{
+			result.words_[i] &= ~other.words_[i];
+		}
+		return result;
+	}
+
+	unsigned int size() const
+	{
+		unsigned int size = 0;
+		for (std::vector<unsigned long long>::const_iterator ci = words_.begin(); ci != words_.end(); ++ci)
+		{
+			size += __builtin_popcountll(*ci);
+		}
+		return size;
+	}
+
+	bool empty() const
+	{
+		for (std::vector<unsigned long long>::const_iterator ci = words_.begin(); ci != words_.end(); ++ci)
+		{
+			if (*ci != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::vector<unsigned long long> words_;
+};
+
+/**
+ * Indexes all the states of the knowledge bases once, such that questions like "which states are part
+ * of this knowledge base" or "in which states does this fluent hold" are answered with bitset operations
+ * instead of walking the states and their mappings. It is shared by the generators, which each have
+ * their own KnowledgeBase (with a states_ member) and State types, and identify a fluent by the objects
+ * it is about, e.g. the (package, bomb) pair of (in ?p ?b ?s).
+ */
+template<class KnowledgeBase, class State, class Fluent>
+struct BeliefState
+{
+	/**
+	 * Stores the fluents that hold in @ref{state} in @ref{fluents}.
+	 */
+	typedef void (*FluentFunction)(const State& state, std::vector<Fluent>& fluents);
+
+	BeliefState(const std::vector<const KnowledgeBase*>& knowledge_bases, FluentFunction get_fluents)
+	{
+		for (typename std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_bases.begin(); ci != knowledge_bases.end(); ++ci)
+		{
+			const KnowledgeBase* knowledge_base = *ci;
+			states_.insert(states_.end(), knowledge_base->states_.begin(), knowledge_base->states_.end());
+		}
+
+		empty_ = StateSet(states_.size());
+		std::vector<Fluent> fluents;
+		unsigned int state_id = 0;
+		for (typename std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_bases.begin(); ci != knowledge_bases.end(); ++ci)
+		{
+			const KnowledgeBase* knowledge_base = *ci;
+			StateSet& kb_states = knowledge_base_states_.insert(std::make_pair(knowledge_base, empty_)).first->second;
+			for (typename std::vector<const State*>::const_iterator ci = knowledge_base->states_.begin(); ci != knowledge_base->states_.end(); ++ci)
+			{
+				kb_states.add(state_id);
+
+				fluents.clear();
+				get_fluents(**ci, fluents);
+				for (typename std::vector<Fluent>::const_iterator ci = fluents.begin(); ci != fluents.end(); ++ci)
+				{
+					fluent_states_.insert(std::make_pair(*ci, empty_)).first->second.add(state_id);
+				}
+				++state_id;
+			}
+		}
+	}
+
+	/**
+	 * @return The states that are part of @ref{knowledge_base}.
+	 */
+	const StateSet& getStates(const KnowledgeBase& knowledge_base) const
+	{
+		typename std::map<const KnowledgeBase*, StateSet>::const_iterator ci = knowledge_base_states_.find(&knowledge_base);
+		if (ci == knowledge_base_states_.end())
+		{
+			return empty_;
+		}
+		return (*ci).second;
+	}
+
+	/**
+	 * @return The states in which @ref{fluent} is true.
+	 */
+	const StateSet& getStates(const Fluent& fluent) const
+	{
+		typename std::map<Fluent, StateSet>::const_iterator ci = fluent_states_.find(fluent);
+		if (ci == fluent_states_.end())
+		{
+			return empty_;
+		}
+		return (*ci).second;
+	}
+
+	/**
+	 * Observing @ref{fluent} only splits @ref{belief} if it is true in some of its states and false in others.
+	 * The generators use this on the initial states to add a static precondition to their sense actions,
+	 * which is sound as long as no action can make a certain fluent uncertain again.
+	 * @return True if sensing @ref{fluent} can have a different outcome for the states in @ref{belief}.
+	 */
+	bool isInformative(const Fluent& fluent, const StateSet& belief) const
+	{
+		const StateSet& true_states = getStates(fluent);
+		return !belief.intersect(true_states).empty() && !belief.subtract(true_states).empty();
+	}
+
+	std::vector<const State*> states_;                               // All the states, indexed by their id.
+	std::map<const KnowledgeBase*, StateSet> knowledge_base_states_;
+	std::map<Fluent, StateSet> fluent_states_;
+	StateSet empty_;
+};
+
+#endif
@@ -5,8 +5,11 @@
 #include <sstream>
 #include <stdlib.h>
 #include <map>
+#include <set>
 #include <boost/concept_check.hpp>
 
+#include "BeliefState.h"
+
 struct Colour
 {
 	Colour(const std::string& name)
@@ -90,6 +93,85 @@ struct KnowledgeBase
 	std::vector<const KnowledgeBase*> children_;
 };
 
+/**
+ * Calculate the number of nested sense actions a plan needs room for: one for every ball whose 
+ * location is uncertain and one for every ball whose colour is uncertain. A branch can also 
+ * never be split more often than it has states.
+ * @param knowledge_base The knowledge bases whose states make up the initial belief.
+ * @param max_depth The depth of the fixed chain, the result is never larger.
+ * @return The number of levels the stack needs beyond l0.
+ */
+unsigned int getBranchingDepth(const std::vector<const KnowledgeBase*>& knowledge_base, unsigned int max_depth)
+{
+	std::map<const Ball*, std::set<const Location*> > possible_locations;
+	std::map<const Ball*, std::set<const Colour*> > possible_colours;
+	unsigned int nr_states = 0;
+	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_base.begin(); ci != knowledge_base.end(); ++ci)
+	{
+		const KnowledgeBase* kb = *ci;
+		for (std::vector<const State*>::const_iterator ci = kb->states_.begin(); ci != kb->states_.end(); ++ci)
+		{
+			const State* state = *ci;
+			for (std::map<const Ball*, const Location*>::const_iterator ci = state->location_mapping_.begin(); ci != state->location_mapping_.end(); ++ci)
+			{
+				possible_locations[(*ci).first].insert((*ci).second);
+			}
+			for (std::map<const Ball*, const Colour*>::const_iterator ci = state->colour_mapping_.begin(); ci != state->colour_mapping_.end(); ++ci)
+			{
+				possible_colours[(*ci).first].insert((*ci).second);
+			}
+			++nr_states;
+		}
+	}
+	
+	unsigned int depth = 0;
+	for (std::map<const Ball*, std::set<const Location*> >::const_iterator ci = possible_locations.begin(); ci != possible_locations.end(); ++ci)
+	{
+		if ((*ci).second.size() > 1)
+		{
+			++depth;
+		}
+	}
+	for (std::map<const Ball*, std::set<const Colour*> >::const_iterator ci = possible_colours.begin(); ci != possible_colours.end(); ++ci)
+	{
+		if ((*ci).second.size() > 1)
+		{
+			++depth;
+		}
+	}
+	
+	if (nr_states > 0 && depth > nr_states - 1)
+	{
+		depth = nr_states - 1;
+	}
+	if (depth > max_depth)
+	{
+		depth = max_depth;
+	}
+	return depth;
+}
+
+typedef std::pair<const Ball*, const Location*> ObjAtFluent; // (obj-at ?o ?l ?s)
+typedef std::pair<const Ball*, const Colour*> ColorFluent;   // (color ?o ?c ?s)
+typedef BeliefState<KnowledgeBase, State, ObjAtFluent> LocationBeliefState;
+typedef BeliefState<KnowledgeBase, State, ColorFluent> ColourBeliefState;
+
+/**
+ * Get the fluents (obj-at ?o ?l) that hold in @ref{state}.
+ */
+void getObjAtFluents(const State& state, std::vector<ObjAtFluent>& fluents)
+{
+	fluents.insert(fluents.end(), state.location_mapping_.begin(), state.location_mapping_.end());
+}
+
+/**
+ * Get the fluents (color ?o ?c) that hold in @ref{state}.
+ */
+void getColorFluents(const State& state, std::vector<ColorFluent>& fluents)
+{
+	fluents.insert(fluents.end(), state.colour_mapping_.begin(), state.colour_mapping_.end());
+}
+
 void generateProblem(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_base, const std::vector<const Location*>& locations, const std::vector<const Ball*>& balls, const std::vector<const Colour*>& colours, const std::vector<const Garbage*>& garbage_places, bool factorise)
 {
 	std::vector<const State*> states;
@@ -103,6 +185,8 @@ void generateProblem(const std::string& file_name, const KnowledgeBase& current_
 		}
 	}
 	
+	unsigned int nr_levels = getBranchingDepth(knowledge_base, balls.size() + colours.size()) + 1;
+	
 	std::ofstream myfile;
 	myfile.open(file_name.c_str());
 	myfile << "(define (problem Keys-0)" << std::endl;
@@ -116,7 +200,7 @@ void generateProblem(const std::string& file_name, const KnowledgeBase& current_
 	}
 	else
 	{
-		for (unsigned int key_nr = 0; key_nr < balls.size() + colours.size() + 1; ++key_nr)
+		for (unsigned int key_nr = 0; key_nr < nr_levels; ++key_nr)
 		{
 			myfile << "\tl" << key_nr << " - LEVEL" << std::endl;
 		}
@@ -134,7 +218,7 @@ void generateProblem(const std::string& file_name, const KnowledgeBase& current_
 	}
 	else
 	{
-		for (unsigned int key_nr = 1; key_nr < balls.size() + colours.size() + 1; ++key_nr)
+		for (unsigned int key_nr = 1; key_nr < nr_levels; ++key_nr)
 		{
 			myfile << "\t(next l" << (key_nr - 1) << " l" << key_nr << ")" << std::endl;
 		}
@@ -215,6 +299,37 @@ void generateProblem(const std::string& file_name, const KnowledgeBase& current_
 			myfile << "\t(parent " << knowledge_base->name_ << " " << (*ci)->name_ << ")" << std::endl;
 		}
 	}
+	
+	// (informative-color ?o ?c) and (informative-obj-at ?o ?l) mark the observations that can split a 
+	// knowledge base. Colours never change and a ball is only picked up where every state agrees it is, 
+	// so a colour or location that is certain initially stays certain.
+	LocationBeliefState location_belief_state(knowledge_base, getObjAtFluents);
+	ColourBeliefState colour_belief_state(knowledge_base, getColorFluents);
+	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_base.begin(); ci != knowledge_base.end(); ++ci)
+	{
+		const KnowledgeBase* kb = *ci;
+		const StateSet& kb_states = location_belief_state.getStates(*kb);
+		std::string kb_name = factorise ? " " + kb->name_ : "";
+		for (std::vector<const Ball*>::const_iterator ci = balls.begin(); ci != balls.end(); ++ci)
+		{
+			const Ball* ball = *ci;
+			for (std::vector<const Colour*>::const_iterator ci = colours.begin(); ci != colours.end(); ++ci)
+			{
+				if (colour_belief_state.isInformative(std::make_pair(ball, *ci), kb_states))
+				{
+					myfile << "\t(informative-color " << ball->name_ << " " << (*ci)->name_ << kb_name << ")" << std::endl;
+				}
+			}
+			
+			for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
+			{
+				if (location_belief_state.isInformative(std::make_pair(ball, *ci), kb_states))
+				{
+					myfile << "\t(informative-obj-at " << ball->name_ << " " << (*ci)->name_ << kb_name << ")" << std::endl;
+				}
+			}
+		}
+	}
 	myfile << ")" << std::endl;
 	myfile << "(:goal (and" << std::endl;
 	if (factorise)
@@ -253,16 +368,8 @@ void generateProblem(const std::string& file_name, const KnowledgeBase& current_
 
 void generateDomain(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const std::vector<const Location*>& locations, const std::vector<const Ball*>& balls, const std::vector<const Colour*>& colours, const std::vector<const Garbage*>& garbage_places, bool factorise)
 {
-	std::vector<const State*> states;
-	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_bases.begin(); ci != knowledge_bases.end(); ++ci)
-	{
-		const KnowledgeBase* knowledge_base = *ci;
-		for (std::vector<const State*>::const_iterator ci = knowledge_base->states_.begin(); ci != knowledge_base->states_.end(); ++ci)
-		{
-			const State* state = *ci;
-			states.push_back(state);
-		}
-	}
+	LocationBeliefState belief_state(knowledge_bases, getObjAtFluents);
+	const std::vector<const State*>& states = belief_state.states_;
 	
 	std::ofstream myfile;
 	myfile.open (file_name.c_str());
@@ -299,6 +406,18 @@ void generateDomain(const std::string& file_name, const KnowledgeBase& current_k
 		myfile << "\t(parent ?kb ?kb2 - knowledgebase)" << std::endl;
 	}
 	
+	// The observations that can split the states (of a knowledge base).
+	if (factorise)
+	{
+		myfile << "\t(informative-color ?o - obj ?c - col ?kb - knowledgebase)" << std::endl;
+		myfile << "\t(informative-obj-at ?o - obj ?p - pos ?kb - knowledgebase)" << std::endl;
+	}
+	else
+	{
+		myfile << "\t(informative-color ?o - obj ?c - col)" << std::endl;
+		myfile << "\t(informative-obj-at ?o - obj ?p - pos)" << std::endl;
+	}
+	
 	myfile << std::endl;
 	myfile << "\t;; Bookkeeping predicates." << std::endl;
 	myfile << "\t(next ?l ?l2 - level)" << std::endl;
@@ -514,11 +633,13 @@ void generateDomain(const std::string& file_name, const KnowledgeBase& current_k
 	
 	if (factorise)
 	{
+		myfile << "\t\t(informative-color ?o ?c ?kb)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (color ?o ?c ?s) (part-of ?s ?kb)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (color ?o ?c ?s)) (part-of ?s ?kb)))" << std::endl;;
 	}
 	else
 	{
+		myfile << "\t\t(informative-color ?o ?c)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (color ?o ?c ?s)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (color ?o ?c ?s))))" << std::endl;;
 	}
@@ -577,11 +698,13 @@ void generateDomain(const std::string& file_name, const KnowledgeBase& current_k
 	
 	if (factorise)
 	{
+		myfile << "\t\t(informative-obj-at ?o ?pos ?kb)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (obj-at ?o ?pos ?s) (part-of ?s ?kb)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (obj-at ?o ?pos ?s)) (part-of ?s ?kb)))" << std::endl;;
 	}
 	else
 	{
+		myfile << "\t\t(informative-obj-at ?o ?pos)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (obj-at ?o ?pos ?s)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (obj-at ?o ?pos ?s))))" << std::endl;;
 	}
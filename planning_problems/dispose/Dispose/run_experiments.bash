@@ -35,6 +35,9 @@ do
 
 			echo "CLG...\n"
 			cd $clg; perl $main/constraint.perl -t 1800 -m 2097152 ./run-clg.sh -1 $main/test_domain.pddl $main/test_problem.pddl | grep "total time\|number of actions" > $main/results/clg_${nr_balls}_${nr_locations}_${nr_colours}.plan; cd $main
+
+			# Or race all the encodings and planners, and keep the first valid plan.
+#			../../run_portfolio.bash dispose_${nr_balls}_${nr_locations}_${nr_colours} ./build/dispose ${nr_balls} ${nr_locations} ${nr_colours}
 			fi
 		done
 	done
@@ -5,8 +5,11 @@
 #include <sstream>
 #include <stdlib.h>
 #include <map>
+#include <set>
 #include <boost/concept_check.hpp>
 
+#include "BeliefState.h"
+
 struct Package
 {
 	Package(const std::string& wp_name)
@@ -66,6 +69,66 @@ struct KnowledgeBase
 	std::vector<const KnowledgeBase*> children_;
 };
 
+/**
+ * Calculate the number of nested sense actions a plan needs room for: one for every bomb whose 
+ * package is uncertain, as the fixed chain of one level per bomb assumed. A branch can also 
+ * never be split more often than it has states.
+ * @param knowledge_base The knowledge bases whose states make up the initial belief.
+ * @param max_depth The depth of the fixed chain, the result is never larger.
+ * @return The number of levels the stack needs beyond l0.
+ */
+unsigned int getBranchingDepth(const std::vector<const KnowledgeBase*>& knowledge_base, unsigned int max_depth)
+{
+	std::map<const Bomb*, std::set<const Package*> > possible_packages;
+	unsigned int nr_states = 0;
+	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_base.begin(); ci != knowledge_base.end(); ++ci)
+	{
+		const KnowledgeBase* kb = *ci;
+		for (std::vector<const State*>::const_iterator ci = kb->states_.begin(); ci != kb->states_.end(); ++ci)
+		{
+			const State* state = *ci;
+			for (std::map<const Bomb*, const Package*>::const_iterator ci = state->mapping_.begin(); ci != state->mapping_.end(); ++ci)
+			{
+				possible_packages[(*ci).first].insert((*ci).second);
+			}
+			++nr_states;
+		}
+	}
+	
+	unsigned int depth = 0;
+	for (std::map<const Bomb*, std::set<const Package*> >::const_iterator ci = possible_packages.begin(); ci != possible_packages.end(); ++ci)
+	{
+		if ((*ci).second.size() > 1)
+		{
+			++depth;
+		}
+	}
+	
+	if (nr_states > 0 && depth > nr_states - 1)
+	{
+		depth = nr_states - 1;
+	}
+	if (depth > max_depth)
+	{
+		depth = max_depth;
+	}
+	return depth;
+}
+
+typedef std::pair<const Package*, const Bomb*> InFluent; // (in ?p ?b ?s)
+typedef BeliefState<KnowledgeBase, State, InFluent> BombBeliefState;
+
+/**
+ * Get the fluents (in ?p ?b) that hold in @ref{state}.
+ */
+void getInFluents(const State& state, std::vector<InFluent>& fluents)
+{
+	for (std::map<const Bomb*, const Package*>::const_iterator ci = state.mapping_.begin(); ci != state.mapping_.end(); ++ci)
+	{
+		fluents.push_back(std::make_pair((*ci).second, (*ci).first));
+	}
+}
+
 void generateProblem(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_base, const std::vector<const Package*>& packages, const std::vector<const Bomb*>& bombs, bool factorise)
 {
 	std::vector<const State*> states;
@@ -79,6 +142,8 @@ void generateProblem(const std::string& file_name, const KnowledgeBase& current_
 		}
 	}
 	
+	unsigned int nr_levels = getBranchingDepth(knowledge_base, bombs.size()) + 1;
+	
 	std::ofstream myfile;
 	myfile.open(file_name.c_str());
 	myfile << "(define (problem Keys-0)" << std::endl;
@@ -92,7 +157,7 @@ void generateProblem(const std::string& file_name, const KnowledgeBase& current_
 	}
 	else
 	{
-		for (unsigned int key_nr = 0; key_nr < bombs.size() + 1; ++key_nr)
+		for (unsigned int key_nr = 0; key_nr < nr_levels; ++key_nr)
 		{
 			myfile << "\tl" << key_nr << " - LEVEL" << std::endl;
 		}
@@ -110,7 +175,7 @@ void generateProblem(const std::string& file_name, const KnowledgeBase& current_
 	}
 	else
 	{
-		for (unsigned int key_nr = 1; key_nr < bombs.size() + 1; ++key_nr)
+		for (unsigned int key_nr = 1; key_nr < nr_levels; ++key_nr)
 		{
 			myfile << "\t(next l" << (key_nr - 1) << " l" << key_nr << ")" << std::endl;
 		}
@@ -162,6 +227,27 @@ void generateProblem(const std::string& file_name, const KnowledgeBase& current_
 			myfile << "\t(parent " << knowledge_base->name_ << " " << (*ci)->name_ << ")" << std::endl;
 		}
 	}
+	
+	// (informative ?p ?b) marks the packages worth sensing for a bomb in a knowledge base. Dunking and 
+	// flushing never move a bomb, so the initial states decide this once and for all.
+	BombBeliefState belief_state(knowledge_base, getInFluents);
+	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_base.begin(); ci != knowledge_base.end(); ++ci)
+	{
+		const KnowledgeBase* kb = *ci;
+		const StateSet& kb_states = belief_state.getStates(*kb);
+		std::string kb_name = factorise ? " " + kb->name_ : "";
+		for (std::vector<const Package*>::const_iterator ci = packages.begin(); ci != packages.end(); ++ci)
+		{
+			const Package* package = *ci;
+			for (std::vector<const Bomb*>::const_iterator ci = bombs.begin(); ci != bombs.end(); ++ci)
+			{
+				if (belief_state.isInformative(std::make_pair(package, *ci), kb_states))
+				{
+					myfile << "\t(informative " << package->name_ << " " << (*ci)->name_ << kb_name << ")" << std::endl;
+				}
+			}
+		}
+	}
 	myfile << ")" << std::endl;
 	myfile << "(:goal (and" << std::endl;
 	if (factorise)
@@ -200,16 +286,8 @@ void generateProblem(const std::string& file_name, const KnowledgeBase& current_
 
 void generateDomain(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const std::vector<const Package*>& packages, const std::vector<const Bomb*>& bombs, bool factorise)
 {
-	std::vector<const State*> states;
-	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_bases.begin(); ci != knowledge_bases.end(); ++ci)
-	{
-		const KnowledgeBase* knowledge_base = *ci;
-		for (std::vector<const State*>::const_iterator ci = knowledge_base->states_.begin(); ci != knowledge_base->states_.end(); ++ci)
-		{
-			const State* state = *ci;
-			states.push_back(state);
-		}
-	}
+	BombBeliefState belief_state(knowledge_bases, getInFluents);
+	const std::vector<const State*>& states = belief_state.states_;
 	
 	std::ofstream myfile;
 	myfile.open (file_name.c_str());
@@ -238,6 +316,16 @@ void generateDomain(const std::string& file_name, const KnowledgeBase& current_k
 		myfile << "\t(parent ?kb ?kb2 - knowledgebase)" << std::endl;
 	}
 	
+	// The observations that can split the states (of a knowledge base).
+	if (factorise)
+	{
+		myfile << "\t(informative ?p - package ?b - bomb ?kb - knowledgebase)" << std::endl;
+	}
+	else
+	{
+		myfile << "\t(informative ?p - package ?b - bomb)" << std::endl;
+	}
+	
 	myfile << std::endl;
 	myfile << "\t;; Bookkeeping predicates." << std::endl;
 	myfile << "\t(next ?l ?l2 - level)" << std::endl;
@@ -383,11 +471,13 @@ void generateDomain(const std::string& file_name, const KnowledgeBase& current_k
 	
 	if (factorise)
 	{
+		myfile << "\t\t(informative ?p ?b ?kb)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (in ?p ?b ?s) (part-of ?s ?kb)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (in ?p ?b ?s)) (part-of ?s ?kb)))" << std::endl;;
 	}
 	else
 	{
+		myfile << "\t\t(informative ?p ?b)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (in ?p ?b ?s)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (in ?p ?b ?s))))" << std::endl;;
 	}
@@ -1004,7 +1094,7 @@ int main(int argc, char **argv)
 	else if (mode == ORIGINAL)
 	{
 		// Enumerate all the possible states.
-		std::vector<int> bomb_locations(packages.size(), 0);
+		std::vector<int> bomb_locations(bombs.size(), 0);
 		
 		bool done = false;
 		unsigned int state_id = 0;
@@ -33,6 +33,9 @@ do
 
 		echo "CLG...\n"
 		cd $clg; perl $main/constraint.perl -t 1800 -m 2097152 ./run-clg.sh -1 $main/test_domain.pddl $main/test_problem.pddl | grep "total time\|number of actions" > $main/results/clg_${bombs}_${packages}.plan; cd $main
+
+		# Or race all the encodings and planners, and keep the first valid plan.
+#		../run_portfolio.bash ebtcs_${bombs}_${packages} ./build/ebtcs ${bombs} ${packages}
 		fi
 	done
 done
@@ -6,6 +6,9 @@
 #include <stdlib.h>
 #include <cmath>
 #include <map>
+#include <set>
+
+#include "BeliefState.h"
 
 struct City;
 
@@ -134,6 +137,63 @@ struct KnowledgeBase
 	std::vector<const State*> states_;
 };
 
+/**
+ * Calculate the number of nested sense actions a plan needs room for: one for every package 
+ * whose location is uncertain, as the fixed chain of one level per package assumed. A branch 
+ * can also never be split more often than it has states.
+ * @param knowledge_base The knowledge bases whose states make up the initial belief.
+ * @param max_depth The depth of the fixed chain, the result is never larger.
+ * @return The number of levels the stack needs beyond l0.
+ */
+unsigned int getBranchingDepth(const std::vector<const KnowledgeBase*>& knowledge_base, unsigned int max_depth)
+{
+	std::map<const Package*, std::set<const Location*> > possible_locations;
+	unsigned int nr_states = 0;
+	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_base.begin(); ci != knowledge_base.end(); ++ci)
+	{
+		const KnowledgeBase* kb = *ci;
+		for (std::vector<const State*>::const_iterator ci = kb->states_.begin(); ci != kb->states_.end(); ++ci)
+		{
+			const State* state = *ci;
+			for (std::map<Package*, Location*>::const_iterator ci = state->packages_.begin(); ci != state->packages_.end(); ++ci)
+			{
+				possible_locations[(*ci).first].insert((*ci).second);
+			}
+			++nr_states;
+		}
+	}
+	
+	unsigned int depth = 0;
+	for (std::map<const Package*, std::set<const Location*> >::const_iterator ci = possible_locations.begin(); ci != possible_locations.end(); ++ci)
+	{
+		if ((*ci).second.size() > 1)
+		{
+			++depth;
+		}
+	}
+	
+	if (nr_states > 0 && depth > nr_states - 1)
+	{
+		depth = nr_states - 1;
+	}
+	if (depth > max_depth)
+	{
+		depth = max_depth;
+	}
+	return depth;
+}
+
+typedef std::pair<const Package*, const StoragePlace*> AtFluent; // (at-ol ?o ?l ?s) and (at-oa ?o ?a ?s)
+typedef BeliefState<KnowledgeBase, State, AtFluent> PackageBeliefState;
+
+/**
+ * Get the fluents (at-ol ?o ?l) that hold in @ref{state}; the packages are never at an airport initially.
+ */
+void getAtFluents(const State& state, std::vector<AtFluent>& fluents)
+{
+	fluents.insert(fluents.end(), state.packages_.begin(), state.packages_.end());
+}
+
 void generateProblem(const std::string& file_name, const std::vector<City*>& cities, const std::vector<Truck*>& trucks, const Airplane& airplane, const std::vector<Package*>& packages)
 {
 	std::ofstream myfile;
@@ -488,6 +548,8 @@ void generateDomain(const std::string& file_name, const std::vector<City*>& citi
 
 void generateProblem(const std::string& file_name, KnowledgeBase& current_knowledge_base,  const std::vector<const KnowledgeBase*>& knowledge_base, const std::vector<City*>& cities, const std::vector<Truck*>& trucks, const Airplane& airplane, const std::vector<Package*>& packages, bool factorise)
 {
+	unsigned int nr_levels = getBranchingDepth(knowledge_base, packages.size()) + 1;
+	
 	std::ofstream myfile;
 	myfile.open(file_name.c_str());
 	myfile << "(define (problem logistics-problem)" << std::endl;
@@ -501,7 +563,7 @@ void generateProblem(const std::string& file_name, KnowledgeBase& current_knowle
 	}
 	else
 	{
-		for (unsigned int i = 0; i < packages.size() + 1; ++i)
+		for (unsigned int i = 0; i < nr_levels; ++i)
 		{
 			myfile << "\tl" << i << " - LEVEL" << std::endl;
 		}
@@ -520,7 +582,7 @@ void generateProblem(const std::string& file_name, KnowledgeBase& current_knowle
 	}
 	else 
 	{
-		for (unsigned int i = 1; i < packages.size() + 1; ++i)
+		for (unsigned int i = 1; i < nr_levels; ++i)
 		{
 			myfile << "\t(next l" << (i - 1) << " l" << i << ")" << std::endl;
 		}
@@ -604,6 +666,40 @@ void generateProblem(const std::string& file_name, KnowledgeBase& current_knowle
 		}
 	}
 	
+	// (informative-l ?obj ?loc) and (informative-a ?obj ?loc) mark the locations worth sensing for a package 
+	// in a knowledge base. A package is only loaded where every state agrees it is, and unloaded the same 
+	// way in all of them, so a location that is certain initially stays certain.
+	PackageBeliefState belief_state(knowledge_base, getAtFluents);
+	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_base.begin(); ci != knowledge_base.end(); ++ci)
+	{
+		const KnowledgeBase* kb = *ci;
+		const StateSet& kb_states = belief_state.getStates(*kb);
+		std::string kb_name = factorise ? " " + kb->name_ : "";
+		for (std::vector<Package*>::const_iterator ci = packages.begin(); ci != packages.end(); ++ci)
+		{
+			const Package* package = *ci;
+			for (std::vector<City*>::const_iterator ci = cities.begin(); ci != cities.end(); ++ci)
+			{
+				const City* city = *ci;
+				for (std::vector<Location*>::const_iterator ci = city->locations_.begin(); ci != city->locations_.end(); ++ci)
+				{
+					if (belief_state.isInformative(AtFluent(package, *ci), kb_states))
+					{
+						myfile << "\t(informative-l " << package->name_ << " " << (*ci)->name_ << kb_name << ")" << std::endl;
+					}
+				}
+				
+				for (std::vector<Airport*>::const_iterator ci = city->airports_.begin(); ci != city->airports_.end(); ++ci)
+				{
+					if (belief_state.isInformative(AtFluent(package, *ci), kb_states))
+					{
+						myfile << "\t(informative-a " << package->name_ << " " << (*ci)->name_ << kb_name << ")" << std::endl;
+					}
+				}
+			}
+		}
+	}
+	
 	std::cout << "Encoding goals..." << std::endl;
 	myfile << ")" << std::endl;
 	myfile << "(:goal (and" << std::endl;
@@ -639,16 +735,8 @@ void generateProblem(const std::string& file_name, KnowledgeBase& current_knowle
 
 void generateDomain(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const std::vector<City*>& cities, const std::vector<Truck*>& trucks, const Airplane& airplane, const std::vector<Package*>& packages, bool factorise)
 {
-	std::vector<const State*> states;
-	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_bases.begin(); ci != knowledge_bases.end(); ++ci)
-	{
-		const KnowledgeBase* knowledge_base = *ci;
-		for (std::vector<const State*>::const_iterator ci = knowledge_base->states_.begin(); ci != knowledge_base->states_.end(); ++ci)
-		{
-			const State* state = *ci;
-			states.push_back(state);
-		}
-	}
+	PackageBeliefState belief_state(knowledge_bases, getAtFluents);
+	const std::vector<const State*>& states = belief_state.states_;
 	
 	std::ofstream myfile;
 	myfile.open (file_name.c_str());
@@ -711,6 +799,18 @@ void generateDomain(const std::string& file_name, const KnowledgeBase& current_k
 		myfile << "\t(parent ?kb ?kb2 - knowledgebase)" << std::endl;
 	}
 	
+	// The observations that can split the states (of a knowledge base).
+	if (factorise)
+	{
+		myfile << "\t(informative-l ?obj - obj ?loc - location ?kb - knowledgebase)" << std::endl;
+		myfile << "\t(informative-a ?obj - obj ?loc - airport ?kb - knowledgebase)" << std::endl;
+	}
+	else
+	{
+		myfile << "\t(informative-l ?obj - obj ?loc - location)" << std::endl;
+		myfile << "\t(informative-a ?obj - obj ?loc - airport)" << std::endl;
+	}
+	
 	myfile << std::endl;
 	myfile << "\t;; Bookkeeping predicates." << std::endl;
 	myfile << "\t(next ?l ?l2 - level)" << std::endl;
@@ -812,11 +912,13 @@ void generateDomain(const std::string& file_name, const KnowledgeBase& current_k
 	myfile << "\t\t;; This action is only applicable if there are world states where the outcome can be different." << std::endl;
 	if (factorise)
 	{
+		myfile << "\t\t(informative-l ?obj ?loc ?kb)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (at-ol ?obj ?loc ?s) (part-of ?s ?kb)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (at-ol ?obj ?loc ?s)) (part-of ?s ?kb)))" << std::endl;;
 	}
 	else
 	{
+		myfile << "\t\t(informative-l ?obj ?loc)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (at-ol ?obj ?loc ?s)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (at-ol ?obj ?loc ?s))))" << std::endl;;
 	}
@@ -873,11 +975,13 @@ void generateDomain(const std::string& file_name, const KnowledgeBase& current_k
 	myfile << "\t\t;; This action is only applicable if there are world states where the outcome can be different." << std::endl;
 	if (factorise)
 	{
+		myfile << "\t\t(informative-a ?obj ?loc ?kb)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (at-oa ?obj ?loc ?s) (part-of ?s ?kb)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (at-oa ?obj ?loc ?s)) (part-of ?s ?kb)))" << std::endl;;
 	}
 	else
 	{
+		myfile << "\t\t(informative-a ?obj ?loc)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (at-oa ?obj ?loc ?s)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (at-oa ?obj ?loc ?s))))" << std::endl;;
 	}
@@ -934,11 +1038,13 @@ void generateDomain(const std::string& file_name, const KnowledgeBase& current_k
 	myfile << "\t\t;; This action is only applicable if there are world states where the outcome can be different." << std::endl;
 	if (factorise)
 	{
+		myfile << "\t\t(informative-a ?obj ?loc ?kb)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (at-oa ?obj ?loc ?s) (part-of ?s ?kb)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (at-oa ?obj ?loc ?s)) (part-of ?s ?kb)))" << std::endl;;
 	}
 	else
 	{
+		myfile << "\t\t(informative-a ?obj ?loc)" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (at-oa ?obj ?loc ?s)))" << std::endl;
 		myfile << "\t\t(exists (?s - state) (and (m ?s) (not (at-oa ?obj ?loc ?s))))" << std::endl;;
 	}
@@ -2075,11 +2181,16 @@ void generateDomain(const std::string& file_name, const KnowledgeBase& current_k
 }
 
 
+// Increase this whenever the generated domains change, see the -d option.
+static const unsigned int DOMAIN_VERSION = 1;
+
 int main(int argc, char **argv)
 {
 	if (argc < 6)
 	{
-		std::cout << "Usage: <number cities> <number locations per city> <number of airports per city> <number of trucks per city> <number of packages per city> {-f}" << std::endl;
+		std::cout << "Usage: <number cities> <number locations per city> <number of airports per city> <number of trucks per city> <number of packages per city> {-f|-p} {-d} {-r <seed>}" << std::endl;
+		std::cout << "-d: Share the domain file between all problems with the same structure." << std::endl;
+		std::cout << "-r: The seed of the initial locations of the trucks (default 1)." << std::endl;
 		return -1;
 	}
 	
@@ -2091,26 +2202,71 @@ int main(int argc, char **argv)
 	
 	enum MODE { ORIGINAL, FACTORISED, PRP};
 	MODE mode = ORIGINAL;
+	bool share_domain = false;
+	unsigned int seed = 1;
 	
-	if (argc == 6)
+	for (int i = 6; i < argc; ++i)
+	{
+		if (std::string(argv[i]) == "-f")
+		{
+			mode = FACTORISED;
+		}
+		else if (std::string(argv[i]) == "-p")
+		{
+			mode = PRP;
+		}
+		else if (std::string(argv[i]) == "-d")
+		{
+			share_domain = true;
+		}
+		else if (std::string(argv[i]) == "-r" && i + 1 < argc)
+		{
+			seed = ::atoi(argv[++i]);
+		}
+		else
+		{
+			std::cerr << "Unknown option " << argv[i] << std::endl;
+			exit(-1);
+		}
+	}
+	
+	std::string mode_name = "original";
+	if (mode == ORIGINAL)
 	{
-		mode = ORIGINAL;
 		std::cout << "ORIGINAL" << std::endl;
 	}
-	else if (std::string(argv[6]) == "-f")
+	else if (mode == FACTORISED)
 	{
-		mode = FACTORISED;
+		mode_name = "factorised";
 		std::cout << "FACTORISED" << std::endl;
 	}
-	else if (std::string(argv[6]) == "-p")
+	else
 	{
-		mode = PRP;
+		mode_name = "prp";
 		std::cout << "PRP" << std::endl;
 	}
-	else
+	
+	srand(seed);
+	std::cout << "Seed: " << seed << std::endl;
+	
+	// The domain only depends on the objects and the states, which are fully determined by the mode and 
+	// the number of objects. The initial locations of the trucks and airplanes, and the destinations of 
+	// the packages, only end up in the problem file. The version is part of the name, such that a domain 
+	// written by an older generator is never combined with a problem of this one.
+	std::string domain_file_name = "test_domain.pddl";
+	bool generate_domain = true;
+	if (share_domain)
 	{
-		std::cerr << "Unknown option " << argv[6] << std::endl;
-		exit(-1);
+		std::stringstream signature;
+		signature << "domain_logistics_v" << DOMAIN_VERSION << "_" << mode_name << "_" << nr_cities << "_" << nr_locations_per_city << "_" << nr_airports_per_city << "_" << nr_trucks_per_city << "_" << nr_packages_per_city << ".pddl";
+		domain_file_name = signature.str();
+		
+		std::ifstream cached_domain(domain_file_name.c_str());
+		if (cached_domain.good())
+		{
+			std::cout << "Reuse the domain file " << domain_file_name << std::endl;
+			generate_domain = false;
+		}
 	}
 	
 	// Create the cities.
@@ -2213,8 +2369,11 @@ int main(int argc, char **argv)
 			}
 		}
 		
-		std::cout << "Generate domain..." << std::endl;
-		generateDomain("test_domain.pddl", basis_kb, knowledge_bases, cities, trucks, *airplane, packages, true);
+		if (generate_domain)
+		{
+			std::cout << "Generate domain..." << std::endl;
+			generateDomain(domain_file_name, basis_kb, knowledge_bases, cities, trucks, *airplane, packages, true);
+		}
 		std::cout << "Generate problem..." << std::endl;
 		generateProblem("test_problem.pddl", basis_kb, knowledge_bases, cities, trucks, *airplane, packages, true);
 	}
@@ -2263,19 +2422,25 @@ int main(int argc, char **argv)
 		
 		
 		
-		std::cout << "Generate domain..." << std::endl;
-		generateDomain("test_domain.pddl", basis_kb, knowledge_bases, cities, trucks, *airplane, packages, false);
+		if (generate_domain)
+		{
+			std::cout << "Generate domain..." << std::endl;
+			generateDomain(domain_file_name, basis_kb, knowledge_bases, cities, trucks, *airplane, packages, false);
+		}
 		std::cout << "Generate problem..." << std::endl;
 		generateProblem("test_problem.pddl", basis_kb, knowledge_bases, cities, trucks, *airplane, packages, false);
 	}
 	else
 	{
-		std::cout << "Generate domain..." << std::endl;
-		generateDomain("test_domain.pddl", cities, trucks, *airplane, packages);
+		if (generate_domain)
+		{
+			std::cout << "Generate domain..." << std::endl;
+			generateDomain(domain_file_name, cities, trucks, *airplane, packages);
+		}
 		std::cout << "Generate problem..." << std::endl;
 		generateProblem("test_problem.pddl", cities, trucks, *airplane, packages);
 	}
-
+	std::cout << "Domain file: " << domain_file_name << std::endl;
 	
 	return 0;
 }
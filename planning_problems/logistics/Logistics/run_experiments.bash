@@ -37,6 +37,9 @@ do
 
 			echo "CLG...\n"
 			cd $clg; perl $main/constraint.perl -t 1800 -m 2097152 ./run-clg.sh -1 $main/test_domain.pddl $main/test_problem.pddl | grep "action\|total time\|number of actions" > $main/results/clg_${nr_cities}_${nr_locations}_${nr_packages}.plan; cd $main
+
+			# Or race all the encodings and planners, and keep the first valid plan.
+#			../../run_portfolio.bash logistics_${nr_cities}_${nr_locations}_${nr_packages} ./build/logistics ${nr_cities} ${nr_locations} 1 1 ${nr_packages}
 		done
 	done
 done
@@ -0,0 +1,119 @@
+#!/bin/bash
+
+# Race several encodings and planners on the same problem and keep the first valid plan.
+#
+# Usage: run_portfolio.bash <name> <generator> [generator arguments]
+#   e.g. (from planning_problems/ebtcs) ../run_portfolio.bash ebtcs_2_3 ./build/ebtcs 2 3
+# It must be run from the directory of the generator, which contains constraint.perl.
+#
+# Every configuration generates its own encoding in a separate directory and runs its planner in its own
+# process group, at most MAX_PLANNERS (by default the number of cores) at the same time; the other
+# configurations are queued and started as soon as a planner ends without a plan. As soon as one planner
+# ends with a valid plan the others are killed.
+# The plan of the winner is stored in results/portfolio_<name>.plan and the winner is appended to
+# results/portfolio.log, such that the configurations can be re-weighted over time.
+
+main=`pwd`
+poprp="/home/bram/projects/factorised_contingent_planning/po-prp/planner-for-relevant-policies/src/"
+clg="/home/bram/planners/clg/CLG_cluster/"
+ff="$HOME/planners/original/FF-X/ff"
+
+# name|generator option|directory to run the planner in|planner command|output of a valid plan
+# DOMAIN and PROBLEM in the planner command are replaced by the files of the encoding. The output of a valid
+# plan is a regular expression that must not match the output of a planner that failed, e.g. CLG prints its
+# total time either way, but only reports the number of actions of a plan it found.
+configurations=(
+	"original||$main|$ff -o DOMAIN -f PROBLEM|found legal plan"
+	"factorised|-f|$main|$ff -o DOMAIN -f PROBLEM|found legal plan"
+	"poprp|-p|$poprp|./poprp DOMAIN PROBLEM|Strong cyclic plan found"
+	"clg|-p|$clg|./run-clg.sh -1 DOMAIN PROBLEM|number of actions"
+)
+
+# We give every planner 30 minutes and 2GB of memory, and by default never run more planners than there are cores.
+time_limit=1800
+memory_limit=2097152
+max_planners=${MAX_PLANNERS:-`nproc`}
+
+if [ $# -lt 2 ];
+then
+	echo "Usage: $0 <name> <generator> [generator arguments]"
+	exit 1
+fi
+name=$1
+generator=`readlink -f $2`
+shift 2
+
+work=`mktemp -d`
+mkdir -p $main/results
+start=`date +%s.%N`
+
+# Generate the encoding of the configuration $1 with the generator arguments that follow it, and start its planner
+# in the background.
+start_planner()
+{
+	IFS='|' read config_name option directory command pattern <<< "$1"
+	shift
+	mkdir $work/$config_name
+	(cd $work/$config_name; $generator "$@" $option > /dev/null)
+
+	command=${command//DOMAIN/$work/$config_name/test_domain.pddl}
+	command=${command//PROBLEM/$work/$config_name/test_problem.pddl}
+	setsid bash -c "cd $directory; perl $main/constraint.perl -t $time_limit -m $memory_limit $command" > $work/$config_name/plan 2>&1 &
+	pids[$config_name]=$!
+	patterns[$config_name]=$pattern
+}
+
+declare -A pids
+declare -A patterns
+next=0
+while [ $next -lt ${#configurations[@]} -a ${#pids[@]} -lt $max_planners ];
+do
+	start_planner "${configurations[$next]}" "$@"
+	next=$((next + 1))
+done
+
+# Wait for the first planner that ends with a valid plan, every planner that ends without one makes room for the
+# next configuration in the queue.
+winner=""
+while [ -z "$winner" -a ${#pids[@]} -gt 0 ];
+do
+	wait -n
+	for config_name in "${!pids[@]}"
+	do
+		if kill -0 ${pids[$config_name]} 2> /dev/null;
+		then
+			continue
+		fi
+		unset pids[$config_name]
+		if grep -q "${patterns[$config_name]}" $work/$config_name/plan;
+		then
+			winner=$config_name
+			break
+		fi
+	done
+
+	while [ -z "$winner" -a $next -lt ${#configurations[@]} -a ${#pids[@]} -lt $max_planners ];
+	do
+		start_planner "${configurations[$next]}" "$@"
+		next=$((next + 1))
+	done
+done
+end=`date +%s.%N`
+
+# Kill the planners that lost, including their children.
+for config_name in "${!pids[@]}"
+do
+	kill -TERM -- -${pids[$config_name]} 2> /dev/null
+done
+wait
+
+if [ -z "$winner" ];
+then
+	echo "$name none `awk "BEGIN { print $end - $start }"`" >> $main/results/portfolio.log
+	echo "No planner found a plan for $name."
+else
+	echo "$name $winner `awk "BEGIN { print $end - $start }"`" >> $main/results/portfolio.log
+	cp $work/$winner/plan $main/results/portfolio_${name}.plan
+	echo "$winner found a plan for $name."
+fi
+rm -rf $work